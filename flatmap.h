@@ -0,0 +1,166 @@
+#pragma once
+
+// detail::flat_map: open-addressing hash map (linear probing, backward-shift deletion) for small keys and values,
+// e.g. window id -> pointer.  All entries live in one contiguous array, a lookup usually touches a single cache line
+// (std::unordered_map: bucket array -> node -> value, one heap allocation per entry).
+// NOTE: Unlike std::unordered_map, insert and erase move other entries - store pointers, when references must stay valid.
+
+#include <functional>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+namespace detail {
+
+// spreads the bits of h over the whole word (std::hash of integers usually is the identity)
+inline std::size_t hash_mix(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// unlike a plain xor, order-dependent and does not cancel out for equal / small values
+inline std::size_t hash_combine(std::size_t seed, std::size_t h)
+{
+  return hash_mix(seed ^ (h + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+// K, V: default-constructible and movable
+template <typename K, typename V, typename Hash = std::hash<K>>
+class flat_map {
+  struct slot {
+    K key{};
+    bool used = false;
+    V value{};
+  };
+
+public:
+  flat_map() = default;
+
+  std::size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  // nullptr: not found
+  V *find(const K &key) {
+    const std::size_t i = lookup(key);
+    return (i != npos) ? &slots[i].value : nullptr;
+  }
+
+  const V *find(const K &key) const {
+    const std::size_t i = lookup(key);
+    return (i != npos) ? &slots[i].value : nullptr;
+  }
+
+  // inserts a default-constructed value, when key is not present.  returns (value, inserted)
+  std::pair<V *, bool> emplace(const K &key) {
+    if ((count + 1) * 4 > slots.size() * 3) { // max. load factor 3/4
+      rehash(slots.empty() ? 16 : slots.size() * 2);
+    }
+    std::size_t i = home(key);
+    for (; slots[i].used; i = (i + 1) & mask) {
+      if (slots[i].key == key) {
+        return {&slots[i].value, false};
+      }
+    }
+    slots[i].key = key;
+    slots[i].used = true;
+    count++;
+    return {&slots[i].value, true};
+  }
+
+  V &operator[](const K &key) {
+    return *emplace(key).first;
+  }
+
+  bool erase(const K &key) {
+    std::size_t hole = lookup(key);
+    if (hole == npos) {
+      return false;
+    }
+    V old = std::move(slots[hole].value); // (destroyed last: its destructor may access the map)
+
+    // move the following entries of the cluster back, unless that would put them before their home slot
+    for (std::size_t j = (hole + 1) & mask; slots[j].used; j = (j + 1) & mask) {
+      if (((j - home(slots[j].key)) & mask) >= ((j - hole) & mask)) {
+        slots[hole].key = std::move(slots[j].key);
+        slots[hole].value = std::move(slots[j].value);
+        hole = j;
+      }
+    }
+    slots[hole] = slot{};
+    count--;
+    (void)old;
+    return true;
+  }
+
+  void clear() {
+    std::vector<slot> tmp;
+    tmp.swap(slots);
+    mask = 0;
+    shift = 64;
+    count = 0;
+  }
+
+  // fn(const K &key, V &value) - must not modify the map
+  template <typename Fn>
+  void for_each(Fn&& fn) {
+    for (slot &s : slots) {
+      if (s.used) {
+        fn(const_cast<const K &>(s.key), s.value);
+      }
+    }
+  }
+
+private:
+  static constexpr std::size_t npos = ~std::size_t(0);
+
+  // fibonacci hashing: the upper bits of the product are well mixed, also for sequential XIDs
+  std::size_t home(const K &key) const {
+    return (uint64_t(Hash{}(key)) * 0x9e3779b97f4a7c15ULL) >> shift;
+  }
+
+  std::size_t lookup(const K &key) const {
+    if (count == 0) {
+      return npos;
+    }
+    for (std::size_t i = home(key); slots[i].used; i = (i + 1) & mask) {
+      if (slots[i].key == key) {
+        return i;
+      }
+    }
+    return npos;
+  }
+
+  void rehash(std::size_t n) { // n: power of 2
+    std::vector<slot> old(n);
+    old.swap(slots);
+    mask = n - 1;
+    for (shift = 64; n > 1; n >>= 1) {
+      shift--;
+    }
+    for (slot &s : old) {
+      if (s.used) {
+        std::size_t i = home(s.key);
+        while (slots[i].used) {
+          i = (i + 1) & mask;
+        }
+        slots[i].key = std::move(s.key);
+        slots[i].used = true;
+        slots[i].value = std::move(s.value);
+      }
+    }
+  }
+
+private:
+  std::vector<slot> slots;
+  std::size_t mask = 0;
+  int shift = 64;
+  std::size_t count = 0;
+};
+
+} // namespace detail
+
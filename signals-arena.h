@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// SignalArena: pool for signal nodes (and the per-type / per-key signal objects of XcbEventCallbacks, XcbDemux).
+// Freed blocks go to per-size free lists and are reused; memory is only returned to the system by ~SignalArena.
+// NOTE: The arena must outlive everything allocated from it. Not thread-safe (like Signal).
+
+class SignalArena final {
+public:
+  // chunk_size is at least the largest pooled block (256 bytes)
+  explicit SignalArena(std::size_t chunk_size = 16384)
+    : chunk_size((chunk_size < max_block) ? max_block : chunk_size)
+  { }
+
+  SignalArena(const SignalArena &) = delete;
+  SignalArena &operator=(const SignalArena &) = delete;
+
+  void *allocate(std::size_t size) {
+    const std::size_t cls = size_class(size);
+    if (cls >= num_classes) {
+      return ::operator new(size);
+    }
+    if (void *ret = free_list[cls]) {
+      free_list[cls] = *static_cast<void **>(ret);
+      return ret;
+    }
+    const std::size_t len = (cls + 1) * granularity;
+    if ((std::size_t)(end - cur) < len) {
+      new_chunk();
+    }
+    void *ret = cur;
+    cur += len;
+    return ret;
+  }
+
+  void deallocate(void *ptr, std::size_t size) {
+    const std::size_t cls = size_class(size);
+    if (cls >= num_classes) {
+      ::operator delete(ptr);
+      return;
+    }
+    *static_cast<void **>(ptr) = free_list[cls];
+    free_list[cls] = ptr;
+  }
+
+  std::size_t capacity() const { // bytes reserved by chunks
+    return chunks.size() * chunk_size;
+  }
+
+private:
+  static constexpr std::size_t granularity = alignof(std::max_align_t);
+  static constexpr std::size_t max_block = 256;
+  static constexpr std::size_t num_classes = max_block / granularity; // larger blocks: ::operator new
+
+  static std::size_t size_class(std::size_t size) {
+    return (size) ? (size - 1) / granularity : 0;
+  }
+
+  void new_chunk() {
+    // (the rest of the old chunk is lost)
+    chunks.emplace_back(new char[chunk_size]); // (new char[] is suitably aligned for any fundamental type)
+    cur = chunks.back().get();
+    end = cur + chunk_size;
+  }
+
+private:
+  std::size_t chunk_size;
+  void *free_list[num_classes] = {};
+  char *cur = nullptr, *end = nullptr;
+  std::vector<std::unique_ptr<char[]>> chunks;
+};
+
+namespace detail {
+
+// objects that might have been allocated in a SignalArena must be released via destroy() (-> arena_ptr)
+struct arena_object {
+  virtual ~arena_object() = default;
+  virtual void destroy() {
+    delete this;
+  }
+};
+
+struct arena_delete {
+  void operator()(arena_object *obj) const {
+    obj->destroy();
+  }
+};
+
+template <typename T>
+using arena_ptr = std::unique_ptr<T, arena_delete>;
+
+template <typename Base>
+struct in_arena final : Base {
+  template <typename... Args>
+  in_arena(SignalArena &arena, Args&&... args)
+    : Base((Args&&)args...), arena(arena)
+  { }
+
+  void destroy() override {
+    SignalArena &a = arena;
+    this->~in_arena();
+    a.deallocate(this, sizeof(in_arena));
+  }
+
+private:
+  SignalArena &arena;
+};
+
+// returns T * (arena == nullptr) or in_arena<T> *
+template <typename T, typename... Args>
+T *arena_new(SignalArena *arena, Args&&... args)
+{
+  if (!arena) {
+    return new T((Args&&)args...);
+  }
+  void *mem = arena->allocate(sizeof(in_arena<T>));
+  try {
+    return new(mem) in_arena<T>{*arena, (Args&&)args...};
+  } catch (...) {
+    arena->deallocate(mem, sizeof(in_arena<T>));
+    throw;
+  }
+}
+
+} // namespace detail
+
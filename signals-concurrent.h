@@ -0,0 +1,479 @@
+#pragma once
+
+// ConcurrentSignal: emit() may be called from any number of threads, while other threads connect / disconnect.
+// emit() takes no lock: it calls the handlers of an immutable snapshot, connect / disconnect publish a new one
+// (under a per-signal mutex) and retire the old one, which is freed once no emit can still be using it
+// (epoch based reclamation, see detail::EpochDomain).
+// Uses the same SignalFlags and reducers as Signal, but has its own ConcurrentConnection; no OnEmptyFn.
+// NOTE: A handler can still be running (or be called by an emit that has already started) after disconnect() returned.
+// NOTE: The ConcurrentSignal itself must outlive all emit() calls on it. Handlers are destroyed when the last snapshot
+// containing them is freed, possibly by another thread; at the latest when the last emit() that can still see them returns.
+
+#include "signals.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+namespace detail {
+
+// Readers announce the global epoch they entered with; retired objects are freed when all announced epochs are newer.
+class EpochDomain final {
+  struct record {
+    char pad0[64];
+    std::atomic<uint64_t> local{0}; // 0: not in a critical section
+    char pad1[56];                  // (no false sharing with other records, even without over-aligned new)
+    unsigned int depth = 0;         // nesting, only used by the owning thread
+    bool in_use = true;
+  };
+
+  struct retired {
+    void *ptr;
+    void (*del)(void *);
+    uint64_t epoch;
+  };
+
+  struct thread_handle {
+    record *rec = nullptr;
+    ~thread_handle() {
+      if (rec) {
+        EpochDomain::instance().release(rec);
+      }
+    }
+  };
+
+public:
+  static EpochDomain &instance() {
+    static EpochDomain domain;
+    return domain;
+  }
+
+  ~EpochDomain() {
+    for (retired &r : retire_list) {
+      r.del(r.ptr);
+    }
+    for (record *rec : records) {
+      delete rec;
+    }
+  }
+
+  struct guard {
+    guard() : rec(EpochDomain::instance().this_thread()) {
+      if (rec->depth++ == 0) {
+        rec->local.store(EpochDomain::instance().epoch.load());
+      }
+    }
+
+    ~guard() {
+      if (--rec->depth == 0) {
+        rec->local.store(0, std::memory_order_release);
+        EpochDomain::instance().collect(); // (this reader may have been the last one holding something back)
+      }
+    }
+
+    guard(const guard &) = delete;
+    guard &operator=(const guard &) = delete;
+
+  private:
+    record *rec;
+  };
+
+  // ptr must already be unreachable for new readers
+  template <typename T>
+  void retire(T *ptr) {
+    const uint64_t cur = epoch.fetch_add(1); // readers that announce a newer epoch cannot see ptr any more
+    std::vector<retired> expired;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      retire_list.push_back({ptr, [](void *p) { delete static_cast<T *>(p); }, cur});
+      npending.store(retire_list.size(), std::memory_order_relaxed);
+      reclaim(expired);
+    }
+    destroy(expired);
+  }
+
+  // frees what no reader can still use; cheap when nothing is pending
+  void collect() {
+    if (!npending.load(std::memory_order_relaxed)) {
+      return;
+    }
+    std::vector<retired> expired;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      reclaim(expired);
+    }
+    destroy(expired);
+  }
+
+private:
+  EpochDomain() = default;
+
+  record *this_thread() {
+    static thread_local thread_handle handle;
+    if (!handle.rec) {
+      handle.rec = acquire();
+    }
+    return handle.rec;
+  }
+
+  record *acquire() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (record *rec : records) {
+      if (!rec->in_use) {
+        rec->in_use = true;
+        return rec;
+      }
+    }
+    records.push_back(new record);
+    return records.back();
+  }
+
+  void release(record *rec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    rec->in_use = false;
+  }
+
+  // mutex must be held; moves the expired entries to out
+  void reclaim(std::vector<retired> &out) {
+    uint64_t oldest = UINT64_MAX;
+    for (record *rec : records) {
+      const uint64_t local = rec->local.load();
+      if (local && local < oldest) {
+        oldest = local;
+      }
+    }
+    auto it = std::partition(retire_list.begin(), retire_list.end(), [oldest](const retired &r) {
+      return r.epoch >= oldest;
+    });
+    out.assign(it, retire_list.end());
+    retire_list.erase(it, retire_list.end());
+    npending.store(retire_list.size(), std::memory_order_relaxed);
+  }
+
+  // without the mutex: destroying a snapshot destroys handlers, which may disconnect / retire themselves
+  static void destroy(const std::vector<retired> &expired) {
+    for (const retired &r : expired) {
+      r.del(r.ptr);
+    }
+  }
+
+private:
+  std::atomic<uint64_t> epoch{1};
+  std::mutex mutex;
+  std::vector<record *> records;
+  std::vector<retired> retire_list;
+  std::atomic<size_t> npending{0}; // retire_list.size(), readable without the mutex
+};
+
+struct ConcurrentSlotBase {
+  virtual ~ConcurrentSlotBase() = default;
+
+  std::atomic<bool> alive{true};
+};
+
+struct ConcurrentCoreBase {
+  virtual ~ConcurrentCoreBase() = default;
+  virtual void remove(ConcurrentSlotBase *slot) = 0;
+};
+
+template <typename Sig>
+struct ConcurrentSlot;
+
+template <typename Ret, typename... Args>
+struct ConcurrentSlot<Ret(Args...)> : ConcurrentSlotBase {
+  using optional_Ret = typename SignalListBase<Ret(Args...)>::optional_Ret;
+
+  ConcurrentSlot(bool once) : once(once) { }
+
+  virtual optional_Ret operator()(Args...) = 0;
+
+  // once: only the emit that wins may call it
+  bool claim() {
+    return !once || !fired.exchange(true);
+  }
+
+  const bool once;
+  std::atomic<bool> fired{false};
+};
+
+// cf. SignalListNode specializations
+template <typename Sig, typename Fn, typename FnRet>
+struct ConcurrentSlotImpl;
+
+template <typename Ret, typename... Args, typename Fn, typename FnRet>
+struct ConcurrentSlotImpl<Ret(Args...), Fn, FnRet> final : ConcurrentSlot<Ret(Args...)> {
+  ConcurrentSlotImpl(Fn&& fn, bool once)
+    : ConcurrentSlot<Ret(Args...)>(once), fn((Fn&&)fn)
+  { }
+
+  simple_optional<Ret> operator()(Args... args) override {
+    return {fn(args...)};
+  }
+
+  Fn fn;
+};
+
+template <typename Ret, typename... Args, typename Fn>
+struct ConcurrentSlotImpl<Ret(Args...), Fn, void> final : ConcurrentSlot<Ret(Args...)> {
+  ConcurrentSlotImpl(Fn&& fn, bool once)
+    : ConcurrentSlot<Ret(Args...)>(once), fn((Fn&&)fn)
+  { }
+
+  simple_optional<Ret> operator()(Args... args) override {
+    fn(args...);
+    return {};
+  }
+
+  Fn fn;
+};
+
+template <typename... Args, typename Fn, typename FnRet>
+struct ConcurrentSlotImpl<void(Args...), Fn, FnRet> final : ConcurrentSlot<void(Args...)> {
+  ConcurrentSlotImpl(Fn&& fn, bool once) : ConcurrentSlot<void(Args...)>(once) {
+    static_assert(std::is_void<FnRet>::value, "Function for ConcurrentSignal<void(...)> must return void or reduce_result_t");
+  }
+  reduce_result_t operator()(Args... args) override { throw 0; }
+};
+
+template <typename... Args, typename Fn>
+struct ConcurrentSlotImpl<void(Args...), Fn, void> final : ConcurrentSlot<void(Args...)> {
+  ConcurrentSlotImpl(Fn&& fn, bool once)
+    : ConcurrentSlot<void(Args...)>(once), fn((Fn&&)fn)
+  { }
+
+  reduce_result_t operator()(Args... args) override {
+    fn(args...);
+    return reduce_result_t::CONTINUE;
+  }
+
+  Fn fn;
+};
+
+template <typename... Args, typename Fn>
+struct ConcurrentSlotImpl<void(Args...), Fn, reduce_result_t> final : ConcurrentSlot<void(Args...)> {
+  ConcurrentSlotImpl(Fn&& fn, bool once)
+    : ConcurrentSlot<void(Args...)>(once), fn((Fn&&)fn)
+  { }
+
+  reduce_result_t operator()(Args... args) override {
+    return fn(args...);
+  }
+
+  Fn fn;
+};
+
+template <typename Sig>
+struct ConcurrentCore final : ConcurrentCoreBase {
+  using slot_t = ConcurrentSlot<Sig>;
+  using snapshot_t = std::vector<std::shared_ptr<slot_t>>; // (immutable once published)
+
+  ~ConcurrentCore() override {
+    delete snapshot.load(); // (no more emits)
+  }
+
+  void insert(std::shared_ptr<slot_t> slot, bool front) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const snapshot_t *cur = snapshot.load(std::memory_order_relaxed);
+    snapshot_t *next = new snapshot_t;
+    next->reserve((cur ? cur->size() : 0) + 1);
+    if (front) {
+      next->push_back(std::move(slot));
+    }
+    if (cur) {
+      next->insert(next->end(), cur->begin(), cur->end());
+    }
+    if (!front) {
+      next->push_back(std::move(slot));
+    }
+    publish(next);
+  }
+
+  void remove(ConcurrentSlotBase *slot) override {
+    std::lock_guard<std::mutex> lock(mutex);
+    slot->alive.store(false);
+    const snapshot_t *cur = snapshot.load(std::memory_order_relaxed);
+    if (!cur) {
+      return;
+    }
+    auto it = std::find_if(cur->begin(), cur->end(), [slot](const std::shared_ptr<slot_t> &s) {
+      return s.get() == slot;
+    });
+    if (it == cur->end()) { // (already removed)
+      return;
+    }
+    snapshot_t *next = nullptr;
+    if (cur->size() > 1) {
+      next = new snapshot_t;
+      next->reserve(cur->size() - 1);
+      next->insert(next->end(), cur->begin(), it);
+      next->insert(next->end(), it + 1, cur->end());
+    }
+    publish(next);
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    const snapshot_t *cur = snapshot.load(std::memory_order_relaxed);
+    if (cur) {
+      for (const std::shared_ptr<slot_t> &s : *cur) {
+        s->alive.store(false);
+      }
+      publish(nullptr);
+    }
+  }
+
+  // mutex must be held
+  void publish(snapshot_t *next) {
+    snapshot_t *old = snapshot.exchange(next);
+    if (old) {
+      EpochDomain::instance().retire(old);
+    }
+  }
+
+  std::mutex mutex;  // writers only
+  std::atomic<snapshot_t *> snapshot{nullptr};
+};
+
+} // namespace detail
+
+struct ConcurrentConnection final {
+  ConcurrentConnection() = default;
+
+  // (does not disconnect, like Connection)
+  ~ConcurrentConnection() = default;
+
+  ConcurrentConnection(ConcurrentConnection &&) = default;
+  ConcurrentConnection &operator=(ConcurrentConnection &&) = default;
+
+  // thread-safe wrt. emit / connect / other connections; but a single ConcurrentConnection must not be shared between threads
+  void disconnect() {
+    std::shared_ptr<detail::ConcurrentCoreBase> c = core.lock();
+    std::shared_ptr<detail::ConcurrentSlotBase> s = slot.lock();
+    if (c && s) {
+      c->remove(s.get());
+    }
+    core.reset();
+    slot.reset();
+  }
+
+  bool connected() const {
+    std::shared_ptr<detail::ConcurrentSlotBase> s = slot.lock();
+    return s && s->alive.load() && !core.expired();
+  }
+
+private:
+  template <typename Sig, typename DefaultRetvalFn>
+  friend class ConcurrentSignal;
+
+  ConcurrentConnection(std::weak_ptr<detail::ConcurrentCoreBase> core, std::weak_ptr<detail::ConcurrentSlotBase> slot)
+    : core(std::move(core)), slot(std::move(slot))
+  { }
+
+  std::weak_ptr<detail::ConcurrentCoreBase> core;
+  std::weak_ptr<detail::ConcurrentSlotBase> slot;
+};
+
+template <typename Sig, typename DefaultRetvalFn = detail::reduce_use_last<void>>
+class ConcurrentSignal;
+
+template <typename Ret, typename... Args, typename DefaultRetvalFn>
+class ConcurrentSignal<Ret(Args...), DefaultRetvalFn> final {
+  using Sig = Ret(Args...);
+  using core_t = detail::ConcurrentCore<Sig>;
+  using slot_t = detail::ConcurrentSlot<Sig>;
+
+  template <typename Fn>
+  using RetOf = decltype(std::declval<Fn>()(std::declval<Args>()...));
+public:
+  ConcurrentSignal() : core(std::make_shared<core_t>()) {
+    detail::EpochDomain::instance(); // (constructed first -> destroyed last)
+  }
+  ConcurrentSignal(const ConcurrentSignal &) = delete;
+  ConcurrentSignal &operator=(const ConcurrentSignal &) = delete;
+
+  ~ConcurrentSignal() {
+    core->clear();
+    detail::EpochDomain::instance().collect();
+  }
+
+  void clear() {
+    core->clear();
+  }
+
+  bool empty() const {
+    return !core->snapshot.load();
+  }
+
+  template <typename Fn>
+  ConcurrentConnection prepend(Fn&& fn, bool once = false) {
+    return insert(std::make_shared<detail::ConcurrentSlotImpl<Sig, Fn, RetOf<Fn>>>((Fn&&)fn, once), true);
+  }
+
+  template <typename Fn>
+  ConcurrentConnection append(Fn&& fn, bool once = false) {
+    return insert(std::make_shared<detail::ConcurrentSlotImpl<Sig, Fn, RetOf<Fn>>>((Fn&&)fn, once), false);
+  }
+
+  template <typename Fn>
+  ConcurrentConnection connect(Fn&& fn, SignalFlags flags = {}) {
+    return (flags & SIGNAL_PREPEND) ? prepend((Fn&&)fn, flags & SIGNAL_ONCE) : append((Fn&&)fn, flags & SIGNAL_ONCE);
+  }
+
+  template <typename ReduceRetvalFn = DefaultRetvalFn,
+            typename = typename std::enable_if<!std::is_void<Ret>::value, ReduceRetvalFn>::type>
+  auto emit(Args... args) -> decltype(((ReduceRetvalFn *)0)->get()) {
+    ReduceRetvalFn ret;
+    detail::EpochDomain::guard guard;
+    const typename core_t::snapshot_t *snap = core->snapshot.load();
+    if (!snap) {
+      return ret.get();
+    }
+    for (const std::shared_ptr<slot_t> &slot : *snap) {
+      if (!slot->alive.load(std::memory_order_acquire) || !slot->claim()) {
+        continue;
+      }
+      auto &&opt = (*slot)(args...);
+      const detail::reduce_result_t res = (opt) ? ret(*opt) : ret();
+      if (res == detail::reduce_result_t::REMOVE_HANDLER || slot->once) {
+        core->remove(slot.get());
+      }
+      if (res == detail::reduce_result_t::STOP) {
+        break;
+      }
+    }
+    return ret.get();
+  }
+
+  template <typename ReduceRetvalFn = DefaultRetvalFn,
+            typename = typename std::enable_if<std::is_void<Ret>::value, ReduceRetvalFn>::type>
+  void emit(Args... args) {
+    detail::EpochDomain::guard guard;
+    const typename core_t::snapshot_t *snap = core->snapshot.load();
+    if (!snap) {
+      return;
+    }
+    for (const std::shared_ptr<slot_t> &slot : *snap) {
+      if (!slot->alive.load(std::memory_order_acquire) || !slot->claim()) {
+        continue;
+      }
+      const detail::reduce_result_t res = (*slot)(args...);
+      if (res == detail::reduce_result_t::REMOVE_HANDLER || slot->once) {
+        core->remove(slot.get());
+      }
+      if (res == detail::reduce_result_t::STOP) {
+        break;
+      }
+    }
+  }
+
+private:
+  ConcurrentConnection insert(std::shared_ptr<slot_t> slot, bool front) {
+    ConcurrentConnection ret{core, slot};
+    core->insert(std::move(slot), front);
+    return ret;
+  }
+
+  std::shared_ptr<core_t> core;
+};
+
@@ -0,0 +1,542 @@
+#pragma once
+
+// FlatSignal: same interface as Signal (signals.h), but all slots are stored in one contiguous array
+// and called via a plain function pointer (no per-node heap allocation, no pointer chasing in emit).
+// Removed slots become tombstones, which are compacted away once no emit is active.
+// Slots removed during an emit keep their function until the outermost emit returns (it might still be running).
+// Slots connected during an emit are kept aside until the outermost emit returns.
+// Uses the same Connection, SignalFlags and reducers as Signal.
+
+#include "signals.h"
+#include <vector>
+
+namespace detail {
+
+template <typename T>
+struct flat_tag { };
+
+template <typename Fn>
+struct flat_holder { // also handles Fn = T& (like SignalListNode)
+  Fn fn;
+};
+
+template <typename Fn,
+          bool Inline = (sizeof(flat_holder<Fn>) <= 2 * sizeof(void *) &&
+                         alignof(flat_holder<Fn>) <= alignof(void *) &&
+                         std::is_nothrow_move_constructible<flat_holder<Fn>>::value)>
+struct flat_fn_ops { // {{{ inline storage
+  static Fn &get(void *storage) {
+    return static_cast<flat_holder<Fn> *>(storage)->fn;
+  }
+
+  static void create(void *storage, Fn&& fn) {
+    new(storage) flat_holder<Fn>{(Fn&&)fn};
+  }
+
+  static void relocate(void *dst, void *src) {
+    flat_holder<Fn> *h = static_cast<flat_holder<Fn> *>(src);
+    new(dst) flat_holder<Fn>{std::move(*h)};
+    h->~flat_holder<Fn>();
+  }
+
+  static void destroy(void *storage) {
+    static_cast<flat_holder<Fn> *>(storage)->~flat_holder<Fn>();
+  }
+};
+// }}}
+
+template <typename Fn>
+struct flat_fn_ops<Fn, false> { // {{{ heap storage
+  static Fn &get(void *storage) {
+    return (*static_cast<flat_holder<Fn> **>(storage))->fn;
+  }
+
+  static void create(void *storage, Fn&& fn) {
+    *static_cast<flat_holder<Fn> **>(storage) = new flat_holder<Fn>{(Fn&&)fn};
+  }
+
+  static void relocate(void *dst, void *src) {
+    *static_cast<flat_holder<Fn> **>(dst) = *static_cast<flat_holder<Fn> **>(src);
+  }
+
+  static void destroy(void *storage) {
+    delete *static_cast<flat_holder<Fn> **>(storage);
+  }
+};
+// }}}
+
+// cf. SignalListNode specializations
+template <typename Sig, typename Fn, typename FnRet>
+struct flat_invoke;
+
+template <typename Ret, typename... Args, typename Fn, typename FnRet>
+struct flat_invoke<Ret(Args...), Fn, FnRet> {
+  static simple_optional<Ret> call(void *storage, Args... args) {
+    return {flat_fn_ops<Fn>::get(storage)(args...)};
+  }
+};
+
+template <typename Ret, typename... Args, typename Fn>
+struct flat_invoke<Ret(Args...), Fn, void> {
+  static simple_optional<Ret> call(void *storage, Args... args) {
+    flat_fn_ops<Fn>::get(storage)(args...);
+    return {};
+  }
+};
+
+template <typename... Args, typename Fn, typename FnRet>
+struct flat_invoke<void(Args...), Fn, FnRet> {
+  static_assert(std::is_void<FnRet>::value, "Function for FlatSignal<void(...)> must return void or reduce_result_t");
+  static reduce_result_t call(void *storage, Args... args) { throw 0; }
+};
+
+template <typename... Args, typename Fn>
+struct flat_invoke<void(Args...), Fn, void> {
+  static reduce_result_t call(void *storage, Args... args) {
+    flat_fn_ops<Fn>::get(storage)(args...);
+    return reduce_result_t::CONTINUE;
+  }
+};
+
+template <typename... Args, typename Fn>
+struct flat_invoke<void(Args...), Fn, reduce_result_t> {
+  static reduce_result_t call(void *storage, Args... args) {
+    return flat_fn_ops<Fn>::get(storage)(args...);
+  }
+};
+
+template <typename Sig>
+struct flat_noop;
+
+template <typename Ret, typename... Args>
+struct flat_noop<Ret(Args...)> {
+  static simple_optional<Ret> call(void *storage, Args... args) {
+    return {};
+  }
+};
+
+template <typename... Args>
+struct flat_noop<void(Args...)> {
+  static reduce_result_t call(void *storage, Args... args) {
+    return reduce_result_t::CONTINUE;
+  }
+};
+
+template <typename Sig>
+struct flat_ops;
+
+template <typename Ret, typename... Args>
+struct flat_ops<Ret(Args...)> {
+  typename SignalListBase<Ret(Args...)>::optional_Ret (*invoke)(void *, Args...);
+  void (*relocate)(void *dst, void *src);
+  void (*destroy)(void *storage);
+};
+
+template <typename Sig, typename Fn, typename FnRet>
+struct flat_ops_for {
+  static const flat_ops<Sig> table;
+};
+
+template <typename Sig, typename Fn, typename FnRet>
+const flat_ops<Sig> flat_ops_for<Sig, Fn, FnRet>::table = {
+  &flat_invoke<Sig, Fn, FnRet>::call, &flat_fn_ops<Fn>::relocate, &flat_fn_ops<Fn>::destroy
+};
+
+template <typename Sig>
+struct FlatSlot;
+
+template <typename Ret, typename... Args>
+struct FlatSlot<Ret(Args...)> final : SignalConnectionBase {
+  using optional_Ret = typename SignalListBase<Ret(Args...)>::optional_Ret;
+  using invoke_t = optional_Ret (*)(void *, Args...);
+
+  template <typename Fn, typename FnRet>
+  FlatSlot(Fn&& fn, bool once, flat_tag<FnRet>)
+    : invoke(flat_ops_for<Ret(Args...), Fn, FnRet>::table.invoke),
+      ops(&flat_ops_for<Ret(Args...), Fn, FnRet>::table),
+      once(once)
+  {
+    flat_fn_ops<Fn>::create(&storage, (Fn&&)fn);
+  }
+
+  FlatSlot(FlatSlot &&rhs) noexcept
+    : invoke(rhs.invoke), ops(rhs.ops),
+      once(rhs.once), dead(rhs.dead), owns(rhs.owns), blocked(rhs.blocked)
+  {
+    if (owns) {
+      ops->relocate(&storage, &rhs.storage);
+      rhs.make_tombstone();
+    }
+    take_conns(rhs);
+  }
+
+  FlatSlot &operator=(FlatSlot &&rhs) noexcept {
+    // assert(this != &rhs);
+    kill();
+    invoke = rhs.invoke;
+    ops = rhs.ops;
+    once = rhs.once;
+    dead = rhs.dead;
+    owns = rhs.owns;
+    blocked = rhs.blocked;
+    if (owns) {
+      ops->relocate(&storage, &rhs.storage);
+      rhs.make_tombstone();
+    }
+    take_conns(rhs);
+    return *this;
+  }
+
+  ~FlatSlot() override {
+    if (owns) {
+      ops->destroy(&storage);
+    }
+  }
+
+  void remove_node(SignalConnectionBase *root) override; // (below)
+
+  // blocked slots are invoked as noop, just like tombstones
+  void set_blocked(bool block) override {
+    blocked = block;
+    if (!dead) {
+      invoke = (block) ? &flat_noop<Ret(Args...)>::call : ops->invoke;
+    }
+  }
+
+  bool is_blocked() const override {
+    return blocked;
+  }
+
+  // -> tombstone
+  void kill() {
+    retire();
+    release();
+  }
+
+  // during emit: the function might still be running, it is only destroyed later (by release())
+  void retire() {
+    disarm();
+    invoke = &flat_noop<Ret(Args...)>::call;
+    once = false;
+    dead = true;
+  }
+
+  void release() {
+    if (owns) {
+      ops->destroy(&storage);
+      owns = false;
+    }
+  }
+
+  // tombstones can still be invoked (void emit does not need to test .dead)
+  void make_tombstone() {
+    invoke = &flat_noop<Ret(Args...)>::call;
+    once = false;
+    dead = true;
+    owns = false;
+  }
+
+  invoke_t invoke;  // ops->invoke, or noop
+  const flat_ops<Ret(Args...)> *ops;
+  typename std::aligned_storage<2 * sizeof(void *), alignof(void *)>::type storage;
+  bool once;
+  bool dead = false;
+  bool owns = true;  // storage holds the function (dead, but not yet released: retired during emit)
+  bool blocked = false;
+};
+
+template <typename Sig>
+struct FlatSignalRoot : SignalConnectionBase {
+  using slot_t = FlatSlot<Sig>;
+
+  void remove_node(SignalConnectionBase *root) override {
+    throw 0;
+  }
+  void set_blocked(bool block) override {
+    throw 0;
+  }
+  bool is_blocked() const override {
+    return false;
+  }
+
+  virtual void emptied() { } // onempty hook
+
+  void remove(slot_t *slot) {
+    // assert(!slot->dead);
+    if (emitting) {
+      slot->retire();
+      ++nretired;
+    } else {
+      slot->kill();
+    }
+    ++ndead;
+    if (--nlive == 0) {
+      if (emitting) {
+        pending_empty = true;
+      } else {
+        slots.clear();
+        ndead = 0;
+        emptied();
+      }
+    } else if (!emitting) {
+      compact();
+    }
+  }
+
+  void clear() {
+    if (!nlive) {
+      return;
+    }
+    if (emitting) {
+      for (std::vector<slot_t> *vec : {&slots, &pending_front, &pending_back}) {
+        for (slot_t &slot : *vec) {
+          if (!slot.dead) {
+            slot.retire();
+            ++nretired;
+          }
+        }
+      }
+      ndead = slots.size() + pending_front.size() + pending_back.size();
+      nlive = 0;
+      pending_empty = true;
+    } else {
+      slots.clear(); // (~FlatSlot disarms the connections)
+      ndead = nlive = 0;
+      emptied();
+    }
+  }
+
+  // connect() during emit: slots must not move (-> not called by the active emit)
+  template <typename... SlotArgs>
+  slot_t *insert(bool front, SlotArgs&&... args) {
+    if (emitting) {
+      std::vector<slot_t> &vec = (front) ? pending_front : pending_back;
+      vec.emplace_back((SlotArgs&&)args...);
+      ++nlive;
+      return &vec.back();
+    } else if (front) {
+      slots.emplace(slots.begin(), (SlotArgs&&)args...);
+      ++nlive;
+      return &slots.front();
+    }
+    slots.emplace_back((SlotArgs&&)args...);
+    ++nlive;
+    return &slots.back();
+  }
+
+  // only when not emitting!
+  void merge_pending() {
+    if (!pending_front.empty()) {
+      std::vector<slot_t> tmp;
+      tmp.reserve(pending_front.size() + slots.size() + pending_back.size());
+      for (auto it = pending_front.rbegin(); it != pending_front.rend(); ++it) { // last prepended comes first
+        tmp.push_back(std::move(*it));
+      }
+      for (slot_t &slot : slots) {
+        tmp.push_back(std::move(slot));
+      }
+      slots.swap(tmp);
+      pending_front.clear();
+    }
+    for (slot_t &slot : pending_back) {
+      slots.push_back(std::move(slot));
+    }
+    pending_back.clear();
+  }
+
+  // only when not emitting!
+  void release_retired() {
+    for (std::vector<slot_t> *vec : {&slots, &pending_front, &pending_back}) {
+      for (slot_t &slot : *vec) {
+        slot.release();
+      }
+    }
+    nretired = 0;
+  }
+
+  // only when not emitting!
+  void compact() {
+    while (!slots.empty() && slots.back().dead) {
+      slots.pop_back();
+      --ndead;
+    }
+    if (ndead < 8 && ndead * 4 < slots.size()) { // amortize
+      return;
+    }
+    size_t j = 0;
+    for (size_t i = 0; i < slots.size(); i++) {
+      if (!slots[i].dead) {
+        if (i != j) {
+          slots[j] = std::move(slots[i]);
+        }
+        j++;
+      }
+    }
+    slots.erase(slots.begin() + j, slots.end());
+    ndead = 0;
+  }
+
+  struct emit_guard {
+    emit_guard(FlatSignalRoot &root) : root(root) {
+      ++root.emitting;
+    }
+
+    ~emit_guard() { // NOTE: emptied() might destroy the signal, must be the last action
+      if (--root.emitting == 0) {
+        if (root.nretired) {
+          root.release_retired();
+        }
+        if (!root.pending_front.empty() || !root.pending_back.empty()) {
+          root.merge_pending();
+        }
+        if (root.ndead) {
+          root.compact();
+        }
+        if (root.pending_empty) {
+          root.pending_empty = false;
+          if (!root.nlive) {
+            root.slots.clear();
+            root.ndead = 0;
+            root.emptied();
+          }
+        }
+      }
+    }
+
+    FlatSignalRoot &root;
+  };
+
+  std::vector<slot_t> slots;
+  std::vector<slot_t> pending_front, pending_back;
+  size_t nlive = 0, ndead = 0, nretired = 0;
+  unsigned int emitting = 0;
+  bool pending_empty = false;
+};
+
+template <typename Ret, typename... Args>
+void FlatSlot<Ret(Args...)>::remove_node(SignalConnectionBase *root)
+{
+  static_cast<FlatSignalRoot<Ret(Args...)> *>(root)->remove(this);
+}
+
+template <typename Sig, typename OnEmptyFn = void>
+struct FlatSignalRootWithEmpty final : FlatSignalRoot<Sig> {
+  FlatSignalRootWithEmpty(OnEmptyFn& onempty)
+    : onempty(onempty)
+  { }
+
+  void emptied() override {
+    onempty();
+  }
+
+private:
+  OnEmptyFn onempty;
+};
+
+template <typename Sig>
+struct FlatSignalRootWithEmpty<Sig, void> final : FlatSignalRoot<Sig> { };
+
+} // namespace detail
+
+template <typename Sig, typename OnEmptyFn = void, typename DefaultRetvalFn = detail::reduce_use_last<void>>
+class FlatSignal;
+
+template <typename Ret, typename... Args, typename OnEmptyFn, typename DefaultRetvalFn>
+class FlatSignal<Ret(Args...), OnEmptyFn, DefaultRetvalFn> final {
+  using Sig = Ret(Args...);
+  using slot_t = detail::FlatSlot<Sig>;
+
+  template <typename Fn>
+  using RetOf = decltype(std::declval<Fn>()(std::declval<Args>()...));
+public:
+  FlatSignal() = default;
+
+  // template to avoid error when OnEmptyFn = void
+  template <typename Fn = OnEmptyFn,
+            typename = typename std::enable_if<std::is_same<Fn, OnEmptyFn>::value>::type>
+  FlatSignal(Fn& onempty) : root{onempty} { }
+
+  template <typename Fn = OnEmptyFn,
+            typename = typename std::enable_if<std::is_same<Fn, OnEmptyFn>::value>::type>
+  FlatSignal(Fn&& onempty) : root{onempty} { }
+
+  void clear() {
+    root.clear();
+  }
+
+  bool empty() const {
+    return !root.nlive;
+  }
+
+  void reserve(size_t n) {
+    root.slots.reserve(n);
+  }
+
+  template <typename Fn>
+  Connection prepend(Fn&& fn, bool once = false) {
+    return {root.insert(true, (Fn&&)fn, once, detail::flat_tag<RetOf<Fn>>{}), &root};
+  }
+
+  template <typename Fn>
+  Connection append(Fn&& fn, bool once = false) {
+    return {root.insert(false, (Fn&&)fn, once, detail::flat_tag<RetOf<Fn>>{}), &root};
+  }
+
+  template <typename Fn>
+  Connection connect(Fn&& fn, SignalFlags flags = {}) {
+    return (flags & SIGNAL_PREPEND) ? prepend((Fn&&)fn, flags & SIGNAL_ONCE) : append((Fn&&)fn, flags & SIGNAL_ONCE);
+  }
+
+  // NOTE: slots connected during emit are only called by later emits (the array is not modified during emit).
+  template <typename ReduceRetvalFn = DefaultRetvalFn,
+            typename = typename std::enable_if<!std::is_void<Ret>::value, ReduceRetvalFn>::type>
+  auto emit(Args... args) -> decltype(((ReduceRetvalFn *)0)->get()) {
+    ReduceRetvalFn ret;
+    typename detail::FlatSignalRoot<Sig>::emit_guard guard{root};
+    slot_t *slot = root.slots.data(), *end = slot + root.slots.size();
+    for (; slot != end; ++slot) {
+      if (slot->dead || slot->blocked) {
+        continue;
+      }
+      auto invoke = slot->invoke;
+      if (slot->once) { // (nested emits must not call it again)
+        root.remove(slot);
+      }
+      auto &&opt = invoke(&slot->storage, args...);
+      const detail::reduce_result_t res = (opt) ? ret(*opt) : ret();
+      if (res == detail::reduce_result_t::REMOVE_HANDLER && !slot->dead) {
+        root.remove(slot);
+      }
+      if (res == detail::reduce_result_t::STOP) {
+        break;
+      }
+    }
+    return ret.get();
+  }
+
+  template <typename ReduceRetvalFn = DefaultRetvalFn,
+            typename = typename std::enable_if<std::is_void<Ret>::value, ReduceRetvalFn>::type>
+  void emit(Args... args) {
+    typename detail::FlatSignalRoot<Sig>::emit_guard guard{root};
+    slot_t *slot = root.slots.data(), *end = slot + root.slots.size();
+    for (; slot != end; ++slot) {
+      auto invoke = slot->invoke;
+      if (slot->once && !slot->blocked) { // (nested emits must not call it again)
+        root.remove(slot);
+      }
+      const detail::reduce_result_t res = invoke(&slot->storage, args...); // (tombstones, blocked: noop)
+      if (res != detail::reduce_result_t::CONTINUE) {
+        if (res == detail::reduce_result_t::REMOVE_HANDLER && !slot->dead) {
+          root.remove(slot);
+        }
+        if (res == detail::reduce_result_t::STOP) {
+          break;
+        }
+      }
+    }
+  }
+
+private:
+  detail::FlatSignalRootWithEmpty<Sig, OnEmptyFn> root;
+};
+
@@ -2,7 +2,11 @@
 
 #include <memory>
 
-// NOTE: During an active emit connections MUST NOT be removed, nor .clear() be called!
+// NOTE: Connections may be removed and .clear() be called during an active emit (also from within the handler itself):
+// Nodes whose handler is currently running are only marked dead, the emit that called them removes them once the handler returns.
+// (.empty() will still return false for such nodes.)
+// Same handler semantics as signals.h: handlers of Signal<void(...)> may return detail::reduce_result_t (STOP, REMOVE_HANDLER),
+// and the short-circuiting reducers (reduce_any, reduce_all, ...) exist here as well. There is no emit_batch.
 
 struct Connection;
 
@@ -48,12 +52,23 @@ private:
   bool active = false;
 };
 
+enum class reduce_result_t : uint8_t {
+  CONTINUE,
+  REMOVE_HANDLER,
+  STOP
+};
+
 // NOTE: actually not needed for Root, but this is the only possible non-templated base type; Node and Root also need a common prev/next Base...
 struct SignalConnectionBase {
   virtual ~SignalConnectionBase();
   virtual void remove_node() = 0;
+  virtual void set_blocked(bool block) = 0;
+  virtual bool is_blocked() const = 0;
 
   ::Connection *conns = {};
+
+protected:
+  void disarm();  // all connections become !connected()
 };
 
 template <typename Sig>
@@ -65,7 +80,8 @@ struct SignalListBase<Ret(Args...)> : SignalConnectionBase {
   SignalListBase(bool once) : once(once) { }
   SignalListBase(SignalListBase &&) = delete;  // TODO?
 
-  using optional_Ret = typename std::conditional<!std::is_void<Ret>::value, simple_optional<Ret>, void>::type;
+  // void signals: handlers may return reduce_result_t (REMOVE_HANDLER, STOP) instead of void
+  using optional_Ret = typename std::conditional<!std::is_void<Ret>::value, simple_optional<Ret>, reduce_result_t>::type;
 
   virtual optional_Ret operator()(Args...) = 0;
 
@@ -74,6 +90,10 @@ struct SignalListBase<Ret(Args...)> : SignalConnectionBase {
   }
 
   void remove_node() override {
+    if (busy) { // handler is running (-> release_node())
+      kill();
+      return;
+    }
     // assert(prev && next);
     next->prev = prev;
 
@@ -82,9 +102,25 @@ struct SignalListBase<Ret(Args...)> : SignalConnectionBase {
     // ~SignalConnectionBase() will now disarm the connections
   }
 
+  void kill() {
+    dead = true;
+    disarm();
+  }
+
+  void set_blocked(bool block) override {
+    blocked = block;
+  }
+
+  bool is_blocked() const override {
+    return blocked;
+  }
+
   SignalListBase *prev = {};
   std::unique_ptr<SignalListBase> next;
   bool once = false;  // unused in SignalListRoot, but shall be accessible with only Base*
+  bool dead = false;
+  bool blocked = false;
+  uint16_t busy = 0;  // number of emits currently calling this node
 };
 
 template <typename Sig, typename Fn, typename FnRet>
@@ -121,9 +157,9 @@ struct SignalListNode<Ret(Args...), Fn, void> final : SignalListBase<Ret(Args...
 template <typename... Args, typename Fn, typename FnRet>
 struct SignalListNode<void(Args...), Fn, FnRet> final : SignalListBase<void(Args...)> {
   SignalListNode(Fn&& fn, bool once) {
-    static_assert(std::is_void<FnRet>::value, "Function for Signal<void(...)> must not return a value");
+    static_assert(std::is_void<FnRet>::value, "Function for Signal<void(...)> must return void or reduce_result_t");
   }
-  void operator()(Args... args) override { throw 0; }
+  reduce_result_t operator()(Args... args) override { throw 0; }
 };
 
 template <typename... Args, typename Fn>
@@ -132,8 +168,22 @@ struct SignalListNode<void(Args...), Fn, void> final : SignalListBase<void(Args.
     : SignalListBase<void(Args...)>(once), fn((Fn&&)fn)
   { }
 
-  void operator()(Args... args) override {
+  reduce_result_t operator()(Args... args) override {
     fn(args...);
+    return reduce_result_t::CONTINUE;
+  }
+
+  Fn fn;
+};
+
+template <typename... Args, typename Fn>
+struct SignalListNode<void(Args...), Fn, reduce_result_t> final : SignalListBase<void(Args...)> {
+  SignalListNode(Fn&& fn, bool once)
+    : SignalListBase<void(Args...)>(once), fn((Fn&&)fn)
+  { }
+
+  reduce_result_t operator()(Args... args) override {
+    return fn(args...);
   }
 
   Fn fn;
@@ -149,10 +199,10 @@ struct SignalListRoot final : SignalListRoot<Sig, void> {
 
   void clear() {
     if (base_t::prev != this) {
-      // SignalListRoot<Sig, void>::clear();
-      base_t::next = std::move(base_t::prev->next);
-      base_t::prev = this;
-      onempty();
+      SignalListRoot<Sig, void>::clear();
+      if (base_t::prev == this) {
+        onempty();
+      }
     }
   }
 
@@ -172,9 +222,20 @@ template <typename Ret, typename... Args>
 struct SignalListRoot<Ret(Args...), void> : SignalListBase<Ret(Args...)> {
   using base_t = SignalListBase<Ret(Args...)>;
 
+  // busy nodes are only marked dead
   void clear() {
-    base_t::next = std::move(base_t::prev->next);
-    base_t::prev = this;
+    base_t *node = this;
+    while (node->next.get() != this) {
+      if (node->next->busy) {
+        node->next->kill();
+        node = node->next.get();
+        continue;
+      }
+      std::unique_ptr<base_t> tmp = std::move(node->next);
+      node->next = std::move(tmp->next);
+      node->next->prev = node;
+    }
+    base_t::prev = node;
   }
   typename base_t::optional_Ret operator()(Args...) override {
     throw 0;
@@ -185,12 +246,6 @@ struct SignalListRoot<Ret(Args...), void> : SignalListBase<Ret(Args...)> {
 //  using base_t::setNext;
 };
 
-enum class reduce_result_t : uint8_t {
-  CONTINUE,
-  REMOVE_HANDLER,
-  STOP
-};
-
 struct reduce_void { // {{{
   reduce_result_t operator()(...) {
     return reduce_result_t::CONTINUE;
@@ -217,6 +272,51 @@ template <>
 struct reduce_use_last<void> : reduce_void { };
 // }}}
 
+// short-circuiting reducers: emit() stops at the first handler that decides the result
+
+struct reduce_any { // {{{
+  reduce_result_t operator()(bool val = false) {
+    any = val;
+    return (val) ? reduce_result_t::STOP : reduce_result_t::CONTINUE;
+  }
+
+  bool get() { return any; }
+
+  bool any = false;
+};
+// }}}
+
+struct reduce_all { // {{{  (true, when there are no handlers)
+  reduce_result_t operator()(bool val = true) {
+    all = val;
+    return (val) ? reduce_result_t::CONTINUE : reduce_result_t::STOP;
+  }
+
+  bool get() { return all; }
+
+  bool all = true;
+};
+// }}}
+
+// input routing: the first handler that returns true consumes the event, get() tells whether it was consumed
+using reduce_consumed = reduce_any;
+
+template <typename T>
+struct reduce_first_non_empty { // {{{  (T: pointer, std::function, ... - anything testable in bool context)
+  reduce_result_t operator()(T val = {}) {
+    if (!val) {
+      return reduce_result_t::CONTINUE;
+    }
+    first = std::move(val);
+    return reduce_result_t::STOP;
+  }
+
+  T get() { return std::move(first); }
+
+  T first{};
+};
+// }}}
+
 } // namespace detail
 
 struct Connection final {
@@ -270,6 +370,23 @@ struct Connection final {
     return node;
   }
 
+  // blocked handlers stay connected (and keep their position), but are skipped by emit
+  void block() {
+    if (node) {
+      node->set_blocked(true);
+    }
+  }
+
+  void unblock() {
+    if (node) {
+      node->set_blocked(false);
+    }
+  }
+
+  bool blocked() const {
+    return node && node->is_blocked();
+  }
+
 private:
   template <typename Sig, typename OnEmptyFn, typename DefaultRetvalFn>
   friend class Signal;
@@ -302,7 +419,34 @@ private:
   Connection **prev, *next;
 };
 
+// blocks conn for the current scope (restores the previous state)
+struct ConnectionBlocker final {
+  explicit ConnectionBlocker(Connection &conn)
+    : conn(conn), was_blocked(conn.blocked())
+  {
+    conn.block();
+  }
+
+  ~ConnectionBlocker() {
+    if (!was_blocked) {
+      conn.unblock();
+    }
+  }
+
+  ConnectionBlocker(const ConnectionBlocker &) = delete;
+  ConnectionBlocker &operator=(const ConnectionBlocker &) = delete;
+
+private:
+  Connection &conn;
+  bool was_blocked;
+};
+
 inline detail::SignalConnectionBase::~SignalConnectionBase()
+{
+  disarm();
+}
+
+inline void detail::SignalConnectionBase::disarm()
 {
   while (conns) {
     conns->node = nullptr;
@@ -387,13 +531,15 @@ public:
   auto emit(Args... args) -> decltype(((ReduceRetvalFn *)0)->get()) {
     ReduceRetvalFn ret;
     for (base_t *node = root ? root->next.get() : root; node != root; node = node->next.get()) {
+      if (!acquire_node(node)) {
+        continue;
+      }
       auto &&opt = (*node)(args...);
       const detail::reduce_result_t res = (opt) ? ret(*opt) : ret();
-      if (res == detail::reduce_result_t::REMOVE_HANDLER || node->once) {
-        node = node->prev;
-        node->next->remove_node();
+      if (res == detail::reduce_result_t::REMOVE_HANDLER) {
+        node->kill();
       }
-      if (res == detail::reduce_result_t::STOP) {
+      if (!release_node(node) || res == detail::reduce_result_t::STOP) {
         return ret.get();
       }
     }
@@ -404,10 +550,15 @@ public:
             typename = typename std::enable_if<std::is_void<Ret>::value, ReduceRetvalFn>::type>
   void emit(Args... args) {
     for (base_t *node = root ? root->next.get() : root; node != root; node = node->next.get()) {
-      (*node)(args...);
-      if (node->once) {
-        node = node->prev;
-        node->next->remove_node();
+      if (!acquire_node(node)) {
+        continue;
+      }
+      const detail::reduce_result_t res = (*node)(args...);
+      if (res == detail::reduce_result_t::REMOVE_HANDLER) {
+        node->kill();
+      }
+      if (!release_node(node) || res == detail::reduce_result_t::STOP) {
+        return;
       }
     }
   }
@@ -423,6 +574,33 @@ private:
     }
   }
 
+  // false: node is blocked or dead (its handler is still running in an outer emit)
+  bool acquire_node(base_t *node) {
+    if (node->dead || node->blocked) {
+      return false;
+    }
+    if (node->once) { // (nested emits must not call it again)
+      node->kill();
+    }
+    ++node->busy;
+    return true;
+  }
+
+  // removes node, when it was disconnected while busy. Afterwards node->next is the next node to call.
+  // false: signal is now empty, onempty() might have destroyed *this
+  bool release_node(base_t *&node) {
+    if (--node->busy || !node->dead) {
+      return true;
+    }
+    if (node->prev == root && node->next.get() == root) {
+      node->remove_node();
+      return false;
+    }
+    node = node->prev;
+    node->next->remove_node();
+    return true;
+  }
+
   void insert_node(base_t *node, std::unique_ptr<base_t> &atnext) {
     // assert(node && atnext);
     // assert(!node->prev && !node->next);
@@ -0,0 +1,179 @@
+#pragma once
+
+// EmitQueue: deferred emits. post() stores the arguments, dispatch() later calls sig.emit(args...),
+// e.g. from XcbConnection::run_once(fn, idle) once the X event queue is drained:
+//   conn.run(handle_event, [&queue]() { queue.dispatch(); });
+// post_coalesced() keeps only the latest arguments per (signal, key) - at the position of the first post.
+// Pending emits live in a SignalArena owned by the queue, i.e. a steady stream of posts does not allocate.
+// Works with any signal type that has emit() (Signal, FlatSignal, StaticSignal, ...).
+// NOTE: A signal must not be destroyed while emits for it are queued - use cancel(sig) first.
+
+#include "signals-arena.h"
+#include "flatmap.h"
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+namespace detail {
+
+template <size_t... Is>
+struct index_list { };
+
+template <size_t N, size_t... Is>
+struct make_index_list : make_index_list<N - 1, N - 1, Is...> { };
+
+template <size_t... Is>
+struct make_index_list<0, Is...> {
+  using type = index_list<Is...>;
+};
+
+struct queued_emit_base : arena_object {
+  virtual void run() = 0;
+};
+
+// the arguments are stored by value and passed to emit() as lvalues
+template <typename SigT, typename... Ts>
+struct queued_emit : queued_emit_base { // (not final: in_arena)
+  template <typename... As>
+  queued_emit(SigT &sig, As&&... as)
+    : sig(&sig), args((As&&)as...)
+  { }
+
+  void run() override {
+    call(typename make_index_list<sizeof...(Ts)>::type());
+  }
+
+  template <size_t... Is>
+  void call(index_list<Is...>) {
+    sig->emit(std::get<Is>(args)...);
+  }
+
+  SigT *sig;
+  std::tuple<Ts...> args;
+};
+
+} // namespace detail
+
+class EmitQueue final {
+public:
+  EmitQueue() = default;
+  EmitQueue(const EmitQueue &) = delete;
+  EmitQueue &operator=(const EmitQueue &) = delete;
+
+  bool empty() const {
+    return queue.empty();
+  }
+
+  template <typename SigT, typename... Ts>
+  void post(SigT &sig, Ts&&... args) {
+    queue.push_back({&sig, 0, false, bind(sig, (Ts&&)args...)});
+  }
+
+  // replaces a pending emit for the same (sig, key)
+  template <typename SigT, typename... Ts>
+  void post_coalesced(uint64_t key, SigT &sig, Ts&&... args) {
+    auto res = index.emplace(key_t{&sig, key}, queue.size());
+    if (res.second) {
+      queue.push_back({&sig, key, true, bind(sig, (Ts&&)args...)});
+    } else {
+      queue[res.first->second].fn = bind(sig, (Ts&&)args...);
+    }
+  }
+
+  template <typename SigT, typename... Ts>
+  void post_coalesced(SigT &sig, Ts&&... args) {
+    post_coalesced(0, sig, (Ts&&)args...);
+  }
+
+  // drops all pending emits for sig (also when called from a handler during dispatch())
+  template <typename SigT>
+  void cancel(SigT &sig) {
+    cancel_if([&sig](const entry &e) { return e.target == &sig; });
+  }
+
+  template <typename SigT>
+  void cancel(uint64_t key, SigT &sig) {
+    cancel_if([&sig, key](const entry &e) { return e.target == &sig && e.coalesced && e.key == key; });
+  }
+
+  // runs the queued emits in order; emits posted meanwhile are also run (i.e. the queue is empty afterwards).
+  // returns number of emits. Called from a handler during dispatch(): does nothing and returns 0
+  // (the outer dispatch() runs everything posted so far).
+  size_t dispatch() {
+    if (dispatching) {
+      return 0;
+    }
+    struct reset {
+      bool &flag;
+      ~reset() { flag = false; }
+    } guard{dispatching};
+    dispatching = true;
+
+    size_t count = 0;
+    while (!queue.empty()) {
+      running.swap(queue);
+      index.clear();
+      for (running_pos = 0; running_pos < running.size(); running_pos++) {
+        entry &e = running[running_pos];
+        if (e.fn) {
+          e.fn->run();
+          count++;
+        }
+      }
+      running.clear();
+    }
+    queue.swap(running); // (both empty: the next posts reuse the buffer just run)
+    return count;
+  }
+
+private:
+  struct entry {
+    const void *target;
+    uint64_t key;
+    bool coalesced;
+    detail::arena_ptr<detail::queued_emit_base> fn;  // empty: cancelled
+  };
+
+  using key_t = std::pair<const void *, uint64_t>;
+
+  struct keyhash {
+    size_t operator()(const key_t &k) const {
+      return detail::hash_combine(std::hash<const void *>()(k.first), std::hash<uint64_t>()(k.second));
+    }
+  };
+
+  template <typename SigT, typename... Ts>
+  detail::arena_ptr<detail::queued_emit_base> bind(SigT &sig, Ts&&... args) {
+    using emit_t = detail::queued_emit<SigT, typename std::decay<Ts>::type...>;
+    return detail::arena_ptr<detail::queued_emit_base>{detail::arena_new<emit_t>(&arena, sig, (Ts&&)args...)};
+  }
+
+  template <typename Pred>
+  void cancel_if(Pred pred) {
+    for (size_t i = 0; i < queue.size(); i++) {
+      if (queue[i].fn && pred(queue[i])) {
+        queue[i].fn = nullptr;
+        if (queue[i].coalesced) {
+          index.erase(key_t{queue[i].target, queue[i].key});
+        }
+      }
+    }
+    for (size_t i = running_pos + 1; i < running.size(); i++) { // (not the currently running entry)
+      if (running[i].fn && pred(running[i])) {
+        running[i].fn = nullptr;
+      }
+    }
+  }
+
+private:
+  SignalArena arena{4096};  // (queued emits; before queue, running: destroyed after them)
+  std::vector<entry> queue, running;
+  size_t running_pos = 0;
+  bool dispatching = false;
+  std::unordered_map<key_t, size_t, keyhash> index;  // coalesced entries in queue
+};
+
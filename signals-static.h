@@ -0,0 +1,135 @@
+#pragma once
+
+// StaticSignal: the set of handlers is fixed at compile time and stored by value in a tuple,
+// emit() calls them directly (no heap nodes, no virtual call -> the compiler can inline the whole fan-out).
+// emit() accepts the same reducers as Signal (handlers of void signals may return reduce_result_t);
+// reduce_result_t::REMOVE_HANDLER disables the handler for later emits.
+//   auto sig = make_static_signal<void(int)>([](int i) { ... }, other_fn);
+
+#include "signals.h"
+#include <bitset>
+#include <tuple>
+
+template <typename Sig, typename... Fns>
+class StaticSignal;
+
+template <typename Ret, typename... Args, typename... Fns>
+class StaticSignal<Ret(Args...), Fns...> final {
+  static constexpr size_t N = sizeof...(Fns);
+
+  template <typename Fn>
+  using RetOf = decltype(std::declval<Fn &>()(std::declval<Args>()...));
+
+  template <bool B>
+  using bool_tag = std::integral_constant<bool, B>;
+
+  template <typename T, typename...>
+  using first_t = typename std::decay<T>::type;
+public:
+  StaticSignal() = default;
+
+  template <typename... Ts,
+            typename = typename std::enable_if<(sizeof...(Ts) == N && N > 0 &&
+                                                !std::is_same<first_t<Ts..., void>, StaticSignal>::value)>::type>
+  explicit StaticSignal(Ts&&... fns)
+    : fns((Ts&&)fns...)
+  { }
+
+  bool empty() const {
+    return removed.all();
+  }
+
+  // re-enables all handlers
+  void reset() {
+    removed.reset();
+  }
+
+  template <size_t I>
+  typename std::tuple_element<I, std::tuple<Fns...>>::type &get() {
+    return std::get<I>(fns);
+  }
+
+  template <typename ReduceRetvalFn = detail::reduce_use_last<void>,
+            typename = typename std::enable_if<!std::is_void<Ret>::value, ReduceRetvalFn>::type>
+  auto emit(Args... args) -> decltype(((ReduceRetvalFn *)0)->get()) {
+    ReduceRetvalFn ret;
+    call<0>(ret, args...);
+    return ret.get();
+  }
+
+  template <typename ReduceRetvalFn = detail::reduce_use_last<void>,
+            typename = typename std::enable_if<std::is_void<Ret>::value, ReduceRetvalFn>::type>
+  void emit(Args... args) {
+    call_void<0>(args...);
+  }
+
+private:
+  template <size_t I, typename ReduceRetvalFn>
+  typename std::enable_if<(I < N)>::type call(ReduceRetvalFn &ret, Args... args) {
+    using Fn = typename std::tuple_element<I, std::tuple<Fns...>>::type;
+    if (!removed[I]) {
+      const detail::reduce_result_t res = invoke(ret, std::get<I>(fns), bool_tag<std::is_void<RetOf<Fn>>::value>{}, args...);
+      if (res == detail::reduce_result_t::REMOVE_HANDLER) {
+        removed.set(I);
+      } else if (res == detail::reduce_result_t::STOP) {
+        return;
+      }
+    }
+    call<I + 1>(ret, args...);
+  }
+
+  template <size_t I, typename ReduceRetvalFn>
+  typename std::enable_if<(I == N)>::type call(ReduceRetvalFn &ret, Args... args) { }
+
+  template <typename ReduceRetvalFn, typename Fn>
+  static detail::reduce_result_t invoke(ReduceRetvalFn &ret, Fn &fn, bool_tag<false>, Args... args) {
+    return ret(fn(args...));
+  }
+
+  template <typename ReduceRetvalFn, typename Fn>
+  static detail::reduce_result_t invoke(ReduceRetvalFn &ret, Fn &fn, bool_tag<true>, Args... args) {
+    fn(args...);
+    return ret();
+  }
+
+  template <size_t I>
+  typename std::enable_if<(I < N)>::type call_void(Args... args) {
+    using Fn = typename std::tuple_element<I, std::tuple<Fns...>>::type;
+    static_assert(std::is_void<RetOf<Fn>>::value || std::is_same<RetOf<Fn>, detail::reduce_result_t>::value,
+                  "Function for StaticSignal<void(...)> must return void or reduce_result_t");
+    if (!removed[I]) {
+      const detail::reduce_result_t res = invoke_void(std::get<I>(fns), bool_tag<std::is_void<RetOf<Fn>>::value>{}, args...);
+      if (res == detail::reduce_result_t::REMOVE_HANDLER) {
+        removed.set(I);
+      } else if (res == detail::reduce_result_t::STOP) {
+        return;
+      }
+    }
+    call_void<I + 1>(args...);
+  }
+
+  template <typename Fn>
+  static detail::reduce_result_t invoke_void(Fn &fn, bool_tag<false>, Args... args) {
+    return fn(args...);
+  }
+
+  template <typename Fn>
+  static detail::reduce_result_t invoke_void(Fn &fn, bool_tag<true>, Args... args) {
+    fn(args...);
+    return detail::reduce_result_t::CONTINUE;
+  }
+
+  template <size_t I>
+  typename std::enable_if<(I == N)>::type call_void(Args... args) { }
+
+private:
+  std::tuple<Fns...> fns;
+  std::bitset<N> removed;
+};
+
+template <typename Sig, typename... Fns>
+StaticSignal<Sig, typename std::decay<Fns>::type...> make_static_signal(Fns&&... fns)
+{
+  return StaticSignal<Sig, typename std::decay<Fns>::type...>{(Fns&&)fns...};
+}
+
@@ -0,0 +1,120 @@
+#pragma once
+
+// SignalStats: instrumentation policy for Signal<Sig, OnEmptyFn, DefaultRetvalFn, SignalStats> and BasicXcbEventCallbacks<SignalStats>.
+// Counts emits and handler calls and collects log2 histograms of the handler durations
+// per slot (Signal) or per event type (XcbEventCallbacks).
+// snapshot() copies everything (e.g. for export), reset() starts over.  Like Signal, not thread-safe.
+//   Signal<void(int), void, detail::reduce_void, SignalStats> sig;
+//   ...
+//   auto snap = sig.instrument().snapshot();
+
+#include <chrono>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include "signals.h"
+
+struct DurationHistogram {
+  static constexpr int BUCKETS = 32;  // bucket i: [2^i, 2^(i+1)) ns (bucket 0 also 0 ns, the last one everything above)
+
+  void add(uint64_t ns) {
+    int idx = 0;
+    for (uint64_t v = ns >> 1; v && idx < BUCKETS - 1; v >>= 1) {
+      idx++;
+    }
+    buckets[idx]++;
+    count++;
+    total_ns += ns;
+    if (ns > max_ns) {
+      max_ns = ns;
+    }
+  }
+
+  // upper bound (in ns) of the bucket that contains the p-quantile, p in [0, 1]
+  uint64_t quantile(double p) const {
+    const uint64_t rank = p * count;
+    uint64_t sum = 0;
+    for (int i = 0; i < BUCKETS - 1; i++) {
+      sum += buckets[i];
+      if (sum > rank) {
+        return (uint64_t(2) << i) - 1;
+      }
+    }
+    return max_ns;
+  }
+
+  uint64_t count = 0, total_ns = 0, max_ns = 0;
+  uint64_t buckets[BUCKETS] = {};
+};
+
+struct SignalStats { // (not final: instrument_holder derives from it)
+  using clock = std::chrono::steady_clock;
+  using timer_t = clock::time_point;
+
+  struct Snapshot {
+    uint64_t emits;  // emits / events seen
+    uint64_t calls;  // handler calls / dispatched events
+    std::vector<std::pair<const void *, DurationHistogram>> slots;  // key: cf. slot()
+    std::vector<std::pair<uint8_t, DurationHistogram>> events;      // key: response type
+  };
+
+  // -- policy hooks
+  void emitted() {
+    emits++;
+  }
+
+  timer_t start() {
+    return clock::now();
+  }
+
+  void slot_done(const void *slot, timer_t t) {
+    calls++;
+    slots[slot].add(elapsed(t));
+  }
+
+  void event_done(uint8_t type, timer_t t) {
+    calls++;
+    events[type].add(elapsed(t));
+  }
+  // --
+
+  uint64_t emit_count() const { return emits; }
+  uint64_t call_count() const { return calls; }
+
+  // nullptr, when conn's handler was not called since the last reset()
+  const DurationHistogram *slot(const Connection &conn) const {
+    return find(slots, static_cast<const void *>(conn.node));
+  }
+
+  const DurationHistogram *event(uint8_t type) const {
+    return find(events, type);
+  }
+
+  Snapshot snapshot() const {
+    return {emits, calls, {slots.begin(), slots.end()}, {events.begin(), events.end()}};
+  }
+
+  // NOTE: slots are identified by their node address, which may be reused after a disconnect; reset() also forgets those.
+  void reset() {
+    emits = calls = 0;
+    slots.clear();
+    events.clear();
+  }
+
+private:
+  static uint64_t elapsed(timer_t t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t).count();
+  }
+
+  template <typename Map, typename Key>
+  static const DurationHistogram *find(const Map &map, const Key &key) {
+    auto it = map.find(key);
+    return (it != map.end()) ? &it->second : nullptr;
+  }
+
+  uint64_t emits = 0, calls = 0;
+  std::unordered_map<const void *, DurationHistogram> slots;
+  std::unordered_map<uint8_t, DurationHistogram> events;
+};
+
@@ -1,10 +1,16 @@
 #pragma once
 
 #include <memory>
+#include <vector>
+#include <stdint.h>
+#include "signals-arena.h"
 
-// NOTE: During an active emit connections MUST NOT be removed, nor .clear() be called!
+// NOTE: Connections may be removed and .clear() be called during an active emit (also from within the handler itself):
+// Nodes whose handler is currently running are only marked dead, the emit that called them removes them once the handler returns.
+// (.empty() will still return false for such nodes.)
 
 struct Connection;
+struct CompactConnection;
 
 enum SignalFlags {
   SIGNAL_DEFAULT = 0,
@@ -48,12 +54,105 @@ private:
   bool active = false;
 };
 
+enum class reduce_result_t : uint8_t {
+  CONTINUE,
+  REMOVE_HANDLER,
+  STOP
+};
+
 // NOTE: actually not needed for Root, but this is the only possible non-templated base type; Node and Root also need a common prev/next Base...
-struct SignalConnectionBase {
-  virtual ~SignalConnectionBase();
+struct SignalConnectionBase : arena_object {
+  ~SignalConnectionBase() override;
   virtual void remove_node(SignalConnectionBase *root) = 0; // actually SignalListBase<...???...> *
+  virtual void set_blocked(bool block) = 0;
+  virtual bool is_blocked() const = 0;
+
+  ::Connection *conns = {};  // or tagged HandleTable index (-> CompactConnection)
+
+  bool has_handle() const {
+    return (uintptr_t)conns & 1;
+  }
+  uint32_t handle_index() const {
+    return (uintptr_t)conns >> 1;
+  }
+  void set_handle_index(uint32_t idx) {
+    conns = (::Connection *)(((uintptr_t)idx << 1) | 1);
+  }
+
+protected:
+  void disarm();  // all connections become !connected()
+  void take_conns(SignalConnectionBase &from);  // for nodes that are relocated in memory (signals-flat.h)
+};
+
+// per-thread table for CompactConnection: index + generation instead of pointers.
+// Node entries also store the table index of their root (roots get an entry when their first node becomes compact).
+// NOTE: Signals with compact connections must be destroyed before their thread exits (i.e. not: static Signal ...).
+class HandleTable final {
+public:
+  static HandleTable &instance() {
+    static thread_local HandleTable table;
+    return table;
+  }
+
+  uint32_t acquire(SignalConnectionBase *ptr, uint32_t root_idx = 0) {
+    uint32_t idx;
+    if (free_head != UINT32_MAX) {
+      idx = free_head;
+      free_head = entries[idx].aux;
+    } else {
+      idx = entries.size();
+      entries.push_back({nullptr, 0, 0});
+    }
+    entries[idx].ptr = ptr;
+    entries[idx].aux = root_idx;
+    return idx;
+  }
+
+  // invalidates all handles to idx
+  void release(uint32_t idx) {
+    entry &e = entries[idx];
+    e.ptr = nullptr;
+    e.gen++;
+    e.aux = free_head;
+    free_head = idx;
+  }
+
+  uint32_t root_index(SignalConnectionBase *root) {
+    if (!root->has_handle()) {
+      // assert(!root->conns);
+      root->set_handle_index(acquire(root));
+    }
+    return root->handle_index();
+  }
+
+  uint32_t generation(uint32_t idx) const {
+    return entries[idx].gen;
+  }
+
+  void relocate(uint32_t idx, SignalConnectionBase *ptr) {
+    entries[idx].ptr = ptr;
+  }
+
+  // nullptr when stale
+  SignalConnectionBase *node(uint32_t idx, uint32_t gen) const {
+    return (idx < entries.size() && entries[idx].gen == gen) ? entries[idx].ptr : nullptr;
+  }
+
+  SignalConnectionBase *root(uint32_t idx) const {
+    return entries[entries[idx].aux].ptr;
+  }
+
+private:
+  HandleTable() = default;
+
+  struct entry {
+    SignalConnectionBase *ptr;
+    uint32_t gen;
+    uint32_t aux;  // root index, or next free entry
+  };
 
-  ::Connection *conns = {};
+  std::vector<entry> entries;
+  uint32_t free_head = UINT32_MAX;
 };
 
 template <typename Sig>
@@ -65,15 +164,22 @@ struct SignalListBase<Ret(Args...)> : SignalConnectionBase {
   SignalListBase(bool once) : once(once) { }
   SignalListBase(SignalListBase &&) = delete;  // TODO?
 
-  using optional_Ret = typename std::conditional<!std::is_void<Ret>::value, simple_optional<Ret>, void>::type;  // ALT: specialization of simple_optional<void> ?
+  // void signals: handlers may return reduce_result_t (REMOVE_HANDLER, STOP) instead of void
+  using optional_Ret = typename std::conditional<!std::is_void<Ret>::value, simple_optional<Ret>, reduce_result_t>::type;  // ALT: specialization of simple_optional<void> ?
 
   virtual optional_Ret operator()(Args...) = 0;
 
-  virtual void setNext(std::unique_ptr<SignalListBase> &node) {
+  using node_ptr = arena_ptr<SignalListBase>;
+
+  virtual void setNext(node_ptr &node) {
     next.swap(node);
   }
 
   void remove_node(SignalConnectionBase *root) override {
+    if (busy) { // handler is running (-> release_node())
+      kill();
+      return;
+    }
     // assert(prev);
     if (next) {
       next->prev = prev;
@@ -81,21 +187,38 @@ struct SignalListBase<Ret(Args...)> : SignalConnectionBase {
       static_cast<SignalListBase *>(root)->prev = prev;
     }
 
-    std::unique_ptr<SignalListBase> tmp = std::move(next);
+    node_ptr tmp = std::move(next);
     prev->setNext(tmp);  // tmp now holds *this and keeps it alive until the current scope ends
     // ~SignalConnectionBase() will now disarm the connections
   }
 
+  void kill() {
+    dead = true;
+    disarm();
+  }
+
+  void set_blocked(bool block) override {
+    blocked = block;
+  }
+
+  bool is_blocked() const override {
+    return blocked;
+  }
+
   SignalListBase *prev = {};
-  std::unique_ptr<SignalListBase> next;
+  node_ptr next;
   bool once = false;  // unused in SignalListRoot, but shall be accessible with only Base*
+  bool dead = false;
+  bool blocked = false;
+  bool batch = false; // -> SignalListBatchBase
+  uint16_t busy = 0;  // number of emits currently calling this node
 };
 
 template <typename Sig, typename Fn, typename FnRet>
 struct SignalListNode;
 
 template <typename Ret, typename... Args, typename Fn, typename FnRet>
-struct SignalListNode<Ret(Args...), Fn, FnRet> final : SignalListBase<Ret(Args...)> {
+struct SignalListNode<Ret(Args...), Fn, FnRet> : SignalListBase<Ret(Args...)> {
   SignalListNode(Fn&& fn, bool once)
     : SignalListBase<Ret(Args...)>(once), fn((Fn&&)fn)
   { }
@@ -108,7 +231,7 @@ struct SignalListNode<Ret(Args...), Fn, FnRet> final : SignalListBase<Ret(Args..
 };
 
 template <typename Ret, typename... Args, typename Fn>
-struct SignalListNode<Ret(Args...), Fn, void> final : SignalListBase<Ret(Args...)> {
+struct SignalListNode<Ret(Args...), Fn, void> : SignalListBase<Ret(Args...)> {
   SignalListNode(Fn&& fn, bool once)
     : SignalListBase<Ret(Args...)>(once), fn((Fn&&)fn)
   { }
@@ -123,26 +246,78 @@ struct SignalListNode<Ret(Args...), Fn, void> final : SignalListBase<Ret(Args...
 
 // generate a nice error:
 template <typename... Args, typename Fn, typename FnRet>
-struct SignalListNode<void(Args...), Fn, FnRet> final : SignalListBase<void(Args...)> {
+struct SignalListNode<void(Args...), Fn, FnRet> : SignalListBase<void(Args...)> {
   SignalListNode(Fn&& fn, bool once) {
-    static_assert(std::is_void<FnRet>::value, "Function for Signal<void(...)> must not return a value");
+    static_assert(std::is_void<FnRet>::value, "Function for Signal<void(...)> must return void or reduce_result_t");
   }
-  void operator()(Args... args) override { throw 0; }
+  reduce_result_t operator()(Args... args) override { throw 0; }
 };
 
 template <typename... Args, typename Fn>
-struct SignalListNode<void(Args...), Fn, void> final : SignalListBase<void(Args...)> {
+struct SignalListNode<void(Args...), Fn, void> : SignalListBase<void(Args...)> {
   SignalListNode(Fn&& fn, bool once)
     : SignalListBase<void(Args...)>(once), fn((Fn&&)fn)
   { }
 
-  void operator()(Args... args) override {
+  reduce_result_t operator()(Args... args) override {
     fn(args...);
+    return reduce_result_t::CONTINUE;
+  }
+
+  Fn fn;
+};
+
+template <typename... Args, typename Fn>
+struct SignalListNode<void(Args...), Fn, reduce_result_t> : SignalListBase<void(Args...)> {
+  SignalListNode(Fn&& fn, bool once)
+    : SignalListBase<void(Args...)>(once), fn((Fn&&)fn)
+  { }
+
+  reduce_result_t operator()(Args... args) override {
+    return fn(args...);
   }
 
   Fn fn;
 };
 
+// batch handlers: fn(const Arg *args, size_t n)
+template <typename Arg>
+struct SignalListBatchBase : SignalListBase<void(Arg)> {
+  using arg_t = typename std::decay<Arg>::type;
+
+  SignalListBatchBase(bool once) : SignalListBase<void(Arg)>(once) {
+    this->batch = true;
+  }
+
+  virtual void call_batch(const arg_t *args, size_t n) = 0;
+};
+
+template <typename Arg, typename Fn>
+struct SignalListBatchNode : SignalListBatchBase<Arg> {
+  SignalListBatchNode(Fn&& fn, bool once)
+    : SignalListBatchBase<Arg>(once), fn((Fn&&)fn)
+  { }
+
+  reduce_result_t operator()(Arg arg) override {
+    fn(&arg, 1);
+    return reduce_result_t::CONTINUE;
+  }
+
+  void call_batch(const typename SignalListBatchBase<Arg>::arg_t *args, size_t n) override {
+    fn(args, n);
+  }
+
+  Fn fn;
+};
+
+template <typename... Args>
+struct batch_arg {
+  struct type; // emit_batch needs exactly one argument
+};
+
+template <typename Arg>
+struct batch_arg<Arg> : std::decay<Arg> { };
+
 template <typename Sig, typename OnEmptyFn = void>
 struct SignalListRoot final : SignalListRoot<Sig, void> {
   using base_t = SignalListBase<Sig>;
@@ -153,14 +328,14 @@ struct SignalListRoot final : SignalListRoot<Sig, void> {
 
   void clear() {
     if (base_t::next) {
-      // SignalListRoot<Sig, void>::clear();
-      base_t::next.reset();
-      base_t::prev = nullptr;
-      onempty();
+      SignalListRoot<Sig, void>::clear();
+      if (!base_t::next) {
+        onempty();
+      }
     }
   }
 
-  void setNext(std::unique_ptr<base_t> &node) override {
+  void setNext(typename base_t::node_ptr &node) override {
     // base_t::setNext(node);
     base_t::next.swap(node);
     if (!base_t::next) {
@@ -176,9 +351,22 @@ template <typename Ret, typename... Args>
 struct SignalListRoot<Ret(Args...), void> : SignalListBase<Ret(Args...)> {
   using base_t = SignalListBase<Ret(Args...)>;
 
+  // busy nodes are only marked dead
   void clear() {
-    base_t::next.reset();
-    base_t::prev = nullptr;
+    base_t *node = this;
+    while (node->next) {
+      if (node->next->busy) {
+        node->next->kill();
+        node = node->next.get();
+        continue;
+      }
+      typename base_t::node_ptr tmp = std::move(node->next);
+      node->next = std::move(tmp->next);
+      if (node->next) {
+        node->next->prev = node;
+      }
+    }
+    base_t::prev = (node != this) ? node : nullptr;
   }
   typename base_t::optional_Ret operator()(Args...) override {
     throw 0;
@@ -189,12 +377,6 @@ struct SignalListRoot<Ret(Args...), void> : SignalListBase<Ret(Args...)> {
 //  using base_t::setNext;
 };
 
-enum class reduce_result_t : uint8_t {
-  CONTINUE,
-  REMOVE_HANDLER,
-  STOP
-};
-
 struct reduce_void { // {{{
   reduce_result_t operator()(...) {
     return reduce_result_t::CONTINUE;
@@ -221,6 +403,70 @@ template <>
 struct reduce_use_last<void> : reduce_void { };
 // }}}
 
+// short-circuiting reducers: emit() stops at the first handler that decides the result
+
+struct reduce_any { // {{{
+  reduce_result_t operator()(bool val = false) {
+    any = val;
+    return (val) ? reduce_result_t::STOP : reduce_result_t::CONTINUE;
+  }
+
+  bool get() { return any; }
+
+  bool any = false;
+};
+// }}}
+
+struct reduce_all { // {{{  (true, when there are no handlers)
+  reduce_result_t operator()(bool val = true) {
+    all = val;
+    return (val) ? reduce_result_t::CONTINUE : reduce_result_t::STOP;
+  }
+
+  bool get() { return all; }
+
+  bool all = true;
+};
+// }}}
+
+// input routing: the first handler that returns true consumes the event, get() tells whether it was consumed
+using reduce_consumed = reduce_any;
+
+template <typename T>
+struct reduce_first_non_empty { // {{{  (T: pointer, std::function, ... - anything testable in bool context)
+  reduce_result_t operator()(T val = {}) {
+    if (!val) {
+      return reduce_result_t::CONTINUE;
+    }
+    first = std::move(val);
+    return reduce_result_t::STOP;
+  }
+
+  T get() { return std::move(first); }
+
+  T first{};
+};
+// }}}
+
+// instrumentation policy (cf. SignalStats in signals-stats.h):
+// emitted() once per emit, start() / slot_done() around each handler call (XcbEventCallbacks: event_done() per dispatched event)
+struct instrument_none { // {{{  (default: everything compiles away)
+  struct timer_t { };
+
+  void emitted() { }
+  timer_t start() { return {}; }
+  void slot_done(const void *slot, timer_t) { }
+  void event_done(uint8_t type, timer_t) { }
+};
+
+// empty base optimization: instrument_none adds nothing to sizeof(Signal)
+template <typename InstrumentFn>
+struct instrument_holder : private InstrumentFn {
+  InstrumentFn &instrument() { return *this; }
+  const InstrumentFn &instrument() const { return *this; }
+};
+// }}}
+
 } // namespace detail
 
 struct Connection final {
@@ -275,10 +521,31 @@ struct Connection final {
     return node;
   }
 
+  // blocked handlers stay connected (and keep their position), but are skipped by emit
+  void block() {
+    if (node) {
+      node->set_blocked(true);
+    }
+  }
+
+  void unblock() {
+    if (node) {
+      node->set_blocked(false);
+    }
+  }
+
+  bool blocked() const {
+    return node && node->is_blocked();
+  }
+
 private:
-  template <typename Sig, typename OnEmptyFn, typename DefaultRetvalFn>
+  template <typename Sig, typename OnEmptyFn, typename DefaultRetvalFn, typename InstrumentFn>
   friend class Signal;
+  template <typename Sig, typename OnEmptyFn, typename DefaultRetvalFn>
+  friend class FlatSignal;
   friend struct detail::SignalConnectionBase;
+  friend struct CompactConnection;
+  friend struct SignalStats;
 
   Connection(detail::SignalConnectionBase *node, detail::SignalConnectionBase *root)
     : node(node), root(root), prev(&node->conns), next(node->conns) {
@@ -307,20 +574,163 @@ private:
   Connection **prev, *next;
 };
 
+// blocks conn for the current scope (restores the previous state)
+struct ConnectionBlocker final {
+  explicit ConnectionBlocker(Connection &conn)
+    : conn(conn), was_blocked(conn.blocked())
+  {
+    conn.block();
+  }
+
+  ~ConnectionBlocker() {
+    if (!was_blocked) {
+      conn.unblock();
+    }
+  }
+
+  ConnectionBlocker(const ConnectionBlocker &) = delete;
+  ConnectionBlocker &operator=(const ConnectionBlocker &) = delete;
+
+private:
+  Connection &conn;
+  bool was_blocked;
+};
+
+// Same semantics as Connection, but only 8 bytes and trivially movable (-> detail::HandleTable).
+//   CompactConnection conn = sig.connect(...);
+struct CompactConnection final {
+  CompactConnection() = default;
+
+  CompactConnection(Connection &&conn) {
+    *this = std::move(conn);
+  }
+
+  ~CompactConnection() {
+    reset();
+  }
+
+  CompactConnection(const CompactConnection &) = delete;
+  CompactConnection(CompactConnection &&rhs) noexcept
+    : index(rhs.index), gen(rhs.gen)
+  {
+    rhs.index = UINT32_MAX;
+  }
+
+  CompactConnection &operator=(CompactConnection &&rhs) noexcept {
+    if (this != &rhs) {
+      reset();
+      index = rhs.index;
+      gen = rhs.gen;
+      rhs.index = UINT32_MAX;
+    }
+    return *this;
+  }
+
+  CompactConnection &operator=(Connection &&conn) {
+    reset();
+    if (!conn.node) {
+      return *this;
+    }
+    detail::SignalConnectionBase *node = conn.node;
+    conn.unlink();
+    conn.node = nullptr;
+    // assert(!node->conns);  (i.e. conn was the only Connection)
+
+    detail::HandleTable &table = detail::HandleTable::instance();
+    index = table.acquire(node, table.root_index(conn.root));
+    gen = table.generation(index);
+    node->set_handle_index(index);
+    return *this;
+  }
+
+  void disconnect() {
+    if (detail::SignalConnectionBase *n = node()) {
+      index = UINT32_MAX;
+      n->remove_node(detail::HandleTable::instance().root(n->handle_index())); // (releases the entry)
+    }
+  }
+
+  bool connected() const {
+    return node();
+  }
+
+  void block() {
+    if (detail::SignalConnectionBase *n = node()) {
+      n->set_blocked(true);
+    }
+  }
+
+  void unblock() {
+    if (detail::SignalConnectionBase *n = node()) {
+      n->set_blocked(false);
+    }
+  }
+
+  bool blocked() const {
+    detail::SignalConnectionBase *n = node();
+    return n && n->is_blocked();
+  }
+
+private:
+  detail::SignalConnectionBase *node() const {
+    return (index != UINT32_MAX) ? detail::HandleTable::instance().node(index, gen) : nullptr;
+  }
+
+  // like ~Connection: the handler stays connected, but can no longer be disconnected
+  void reset() {
+    if (detail::SignalConnectionBase *n = node()) {
+      n->conns = nullptr;
+      detail::HandleTable::instance().release(index);
+    }
+    index = UINT32_MAX;
+  }
+
+  uint32_t index = UINT32_MAX;
+  uint32_t gen = 0;
+};
+
 inline detail::SignalConnectionBase::~SignalConnectionBase()
 {
+  disarm();
+}
+
+inline void detail::SignalConnectionBase::disarm()
+{
+  if (has_handle()) { // (node or root)
+    HandleTable::instance().release(handle_index());
+    conns = nullptr;
+    return;
+  }
   while (conns) {
     conns->node = nullptr;
     conns = conns->next;
   }
 }
 
+inline void detail::SignalConnectionBase::take_conns(SignalConnectionBase &from)
+{
+  // assert(!conns);
+  conns = from.conns;
+  from.conns = nullptr;
+  if (has_handle()) {
+    HandleTable::instance().relocate(handle_index(), this);
+    return;
+  }
+  if (conns) {
+    conns->prev = &conns;
+  }
+  for (::Connection *c = conns; c; c = c->next) {
+    c->node = this;
+  }
+}
+
 //template <typename Sig, typename OnEmptyFn = void, typename DefaultRetvalFn = detail::reduce_void>
-template <typename Sig, typename OnEmptyFn = void, typename DefaultRetvalFn = detail::reduce_use_last<void>>
+template <typename Sig, typename OnEmptyFn = void, typename DefaultRetvalFn = detail::reduce_use_last<void>,
+          typename InstrumentFn = detail::instrument_none>
 class Signal;
 
-template <typename Ret, typename... Args, typename OnEmptyFn, typename DefaultRetvalFn>
-class Signal<Ret(Args...), OnEmptyFn, DefaultRetvalFn> final {
+template <typename Ret, typename... Args, typename OnEmptyFn, typename DefaultRetvalFn, typename InstrumentFn>
+class Signal<Ret(Args...), OnEmptyFn, DefaultRetvalFn, InstrumentFn> final : private detail::instrument_holder<InstrumentFn> {
   using Sig = Ret(Args...);
   using base_t = detail::SignalListBase<Sig>;
 
@@ -332,11 +742,17 @@ public:
   // template to avoid error when OnEmptyFn = void
   template <typename Fn = OnEmptyFn,
             typename = typename std::enable_if<std::is_same<Fn, OnEmptyFn>::value>::type>
-  Signal(Fn& onempty) : root{onempty} { }
+  Signal(Fn& onempty, SignalArena *arena = nullptr) : root{onempty}, arena(arena) { }
 
   template <typename Fn = OnEmptyFn,
             typename = typename std::enable_if<std::is_same<Fn, OnEmptyFn>::value>::type>
-  Signal(Fn&& onempty) : root{onempty} { }
+  Signal(Fn&& onempty, SignalArena *arena = nullptr) : root{onempty}, arena(arena) { }
+
+  // nodes will be allocated from arena
+  explicit Signal(SignalArena *arena) : arena(arena) { }
+
+  // e.g. instrument().snapshot() with InstrumentFn = SignalStats
+  using detail::instrument_holder<InstrumentFn>::instrument;
 
   void clear() {
     root.clear();
@@ -348,32 +764,12 @@ public:
 
   template <typename Fn>
   Connection prepend(Fn&& fn, bool once = false) {
-    auto node = new detail::SignalListNode<Sig, Fn, RetOf<Fn>>{(Fn&&)fn, once};
-    if (root.next) {
-      root.next->prev = node;
-      node->next = std::move(root.next);
-    } else {
-      root.prev = node;
-    }
-    root.next.reset(node);
-    node->prev = &root;
-    return {node, &root};
+    return link_front(detail::arena_new<detail::SignalListNode<Sig, Fn, RetOf<Fn>>>(arena, (Fn&&)fn, once));
   }
 
   template <typename Fn>
   Connection append(Fn&& fn, bool once = false) {
-    auto node = new detail::SignalListNode<Sig, Fn, RetOf<Fn>>{(Fn&&)fn, once};
-    if (root.prev) {
-      // assert(!root.prev->next);
-      root.prev->next.reset(node);
-      node->prev = root.prev;
-      // NOTE: node->next must stay empty, because root is already owned
-    } else {
-      root.next.reset(node);
-      node->prev = &root;
-    }
-    root.prev = node;
-    return {node, &root};
+    return link_back(detail::arena_new<detail::SignalListNode<Sig, Fn, RetOf<Fn>>>(arena, (Fn&&)fn, once));
   }
 
   template <typename Fn>
@@ -381,18 +777,74 @@ public:
     return (flags & SIGNAL_PREPEND) ? prepend((Fn&&)fn, flags & SIGNAL_ONCE) : append((Fn&&)fn, flags & SIGNAL_ONCE);
   }
 
+  using batch_arg_t = typename detail::batch_arg<Args...>::type;
+
+  // fn(const batch_arg_t *args, size_t n); also called by emit() (with n == 1)
+  template <typename Fn>
+  Connection connect_batch(Fn&& fn, SignalFlags flags = {}) {
+    static_assert(std::is_void<Ret>::value && sizeof...(Args) == 1, "connect_batch requires Signal<void(Arg)>");
+    auto node = detail::arena_new<detail::SignalListBatchNode<Args..., Fn>>(arena, (Fn&&)fn, flags & SIGNAL_ONCE);
+    return (flags & SIGNAL_PREPEND) ? link_front(node) : link_back(node);
+  }
+
+  // Handler-major: each handler gets the whole batch (a SIGNAL_ONCE handler only the first element) before the next handler is called,
+  // i.e. unlike n emit() calls, handlers do not see the elements interleaved.
+  // STOP from a handler only stops that element (from then on, batch handlers get the remaining elements one by one).
+  void emit_batch(const batch_arg_t *args, size_t n) {
+    static_assert(std::is_void<Ret>::value && sizeof...(Args) == 1, "emit_batch requires Signal<void(Arg)>");
+    if (!n) {
+      return;
+    }
+    instrument().emitted();
+    std::vector<bool> stopped; // (only allocated when needed)
+    for (base_t *node = root.next.get(); node; node = node->next.get()) {
+      if (!acquire_node(node)) {
+        continue;
+      }
+      auto t = instrument().start();
+      if (node->batch && stopped.empty()) {
+        static_cast<detail::SignalListBatchBase<Args...> *>(node)->call_batch(args, (node->once) ? 1 : n);
+      } else {
+        for (size_t i = 0; i < n; i++) {
+          if (!stopped.empty() && stopped[i]) {
+            continue;
+          }
+          const detail::reduce_result_t res = (*node)(args[i]);
+          if (res == detail::reduce_result_t::STOP) {
+            stopped.resize(n);
+            stopped[i] = true;
+          } else if (res == detail::reduce_result_t::REMOVE_HANDLER) {
+            node->kill();
+          }
+          if (node->dead) { // (once, or disconnected)
+            break;
+          }
+        }
+      }
+      instrument().slot_done(slot_id(node), t);
+      if (!release_node(node)) {
+        return;
+      }
+    }
+  }
+
   template <typename ReduceRetvalFn = DefaultRetvalFn,
             typename = typename std::enable_if<!std::is_void<Ret>::value, ReduceRetvalFn>::type>
   auto emit(Args... args) -> decltype(((ReduceRetvalFn *)0)->get()) {
     ReduceRetvalFn ret;
+    instrument().emitted();
     for (base_t *node = root.next.get(); node; node = node->next.get()) {
+      if (!acquire_node(node)) {
+        continue;
+      }
+      auto t = instrument().start();
       auto &&opt = (*node)(args...);
+      instrument().slot_done(slot_id(node), t);
       const detail::reduce_result_t res = (opt) ? ret(*opt) : ret();
-      if (res == detail::reduce_result_t::REMOVE_HANDLER || node->once) {
-        node = node->prev;
-        node->next->remove_node(&root);
+      if (res == detail::reduce_result_t::REMOVE_HANDLER) {
+        node->kill();
       }
-      if (res == detail::reduce_result_t::STOP) {
+      if (!release_node(node) || res == detail::reduce_result_t::STOP) {
         return ret.get();
       }
     }
@@ -402,16 +854,83 @@ public:
   template <typename ReduceRetvalFn = DefaultRetvalFn,
             typename = typename std::enable_if<std::is_void<Ret>::value, ReduceRetvalFn>::type>
   void emit(Args... args) {
+    instrument().emitted();
     for (base_t *node = root.next.get(); node; node = node->next.get()) {
-      (*node)(args...);
-      if (node->once) {
-        node = node->prev;
-        node->next->remove_node(&root);
+      if (!acquire_node(node)) {
+        continue;
+      }
+      auto t = instrument().start();
+      const detail::reduce_result_t res = (*node)(args...);
+      instrument().slot_done(slot_id(node), t);
+      if (res == detail::reduce_result_t::REMOVE_HANDLER) {
+        node->kill();
+      }
+      if (!release_node(node) || res == detail::reduce_result_t::STOP) {
+        return;
       }
     }
   }
 
 private:
+  Connection link_front(base_t *node) {
+    if (root.next) {
+      root.next->prev = node;
+      node->next = std::move(root.next);
+    } else {
+      root.prev = node;
+    }
+    root.next.reset(node);
+    node->prev = &root;
+    return {node, &root};
+  }
+
+  Connection link_back(base_t *node) {
+    if (root.prev) {
+      // assert(!root.prev->next);
+      root.prev->next.reset(node);
+      node->prev = root.prev;
+      // NOTE: node->next must stay empty, because root is already owned
+    } else {
+      root.next.reset(node);
+      node->prev = &root;
+    }
+    root.prev = node;
+    return {node, &root};
+  }
+
+  // same as Connection::node
+  static const void *slot_id(base_t *node) {
+    return static_cast<detail::SignalConnectionBase *>(node);
+  }
+
+  // false: node is blocked or dead (its handler is still running in an outer emit)
+  bool acquire_node(base_t *node) {
+    if (node->dead || node->blocked) {
+      return false;
+    }
+    if (node->once) { // (nested emits must not call it again)
+      node->kill();
+    }
+    ++node->busy;
+    return true;
+  }
+
+  // removes node, when it was disconnected while busy. Afterwards node->next is the next node to call.
+  // false: signal is now empty, onempty() might have destroyed *this
+  bool release_node(base_t *&node) {
+    if (--node->busy || !node->dead) {
+      return true;
+    }
+    if (node->prev == &root && !node->next) {
+      node->remove_node(&root);
+      return false;
+    }
+    node = node->prev;
+    node->next->remove_node(&root);
+    return true;
+  }
+
   detail::SignalListRoot<Sig, OnEmptyFn> root;
+  SignalArena *arena = nullptr;
 };
 
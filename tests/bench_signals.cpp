@@ -0,0 +1,227 @@
+#include "../signals.h"
+#include "../signals-flat.h"
+#include "../signals-static.h"
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include <memory>
+
+// g++ -Wall -std=c++11 -O2 -o bench_signals bench_signals.cpp
+
+static unsigned int counter = 0;
+
+// several handler types, as in a real program (a single one would allow the compiler to devirtualize Signal)
+template <int N>
+struct slot_fn {
+  void operator()(int i) {
+    counter += (i ^ N) + x;
+  }
+  unsigned int x;
+};
+
+template <typename Sig>
+static Connection connect_some(Sig &sig, unsigned int i)
+{
+  switch (i % 4) {
+  case 0: return sig.connect(slot_fn<0>{i});
+  case 1: return sig.connect(slot_fn<1>{i});
+  case 2: return sig.connect(slot_fn<2>{i});
+  default: return sig.connect(slot_fn<3>{i});
+  }
+}
+
+template <typename Sig>
+static double bench_emit(Sig &sig, int emits)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < emits; i++) {
+    sig.emit(i);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / emits;
+}
+
+// interleave other allocations, like in a real program, so list nodes do not end up adjacent
+template <typename Sig>
+static void fill(Sig &sig, std::vector<Connection> &conns, int slots)
+{
+  std::vector<std::unique_ptr<char[]>> garbage;
+  for (int i = 0; i < slots; i++) {
+    conns.push_back(connect_some(sig, i));
+    for (int j = 0; j < 8; j++) {
+      garbage.emplace_back(new char[48 + 16 * j]);
+    }
+  }
+  // churn: remove every third, and connect again
+  for (int i = 0; i < slots; i += 3) {
+    conns[i].disconnect();
+    conns[i] = connect_some(sig, i);
+  }
+}
+
+int main()
+{
+  const int sizes[] = {4, 32, 256};
+  for (int slots : sizes) {
+    const int emits = 4000000 / slots;
+
+    Signal<void(int)> sig;
+    std::vector<Connection> conns;
+    fill(sig, conns, slots);
+
+    FlatSignal<void(int)> fsig;
+    std::vector<Connection> fconns;
+    fill(fsig, fconns, slots);
+
+    bench_emit(sig, emits / 10); // warm up
+    const double list_ns = bench_emit(sig, emits);
+    bench_emit(fsig, emits / 10);
+    const double flat_ns = bench_emit(fsig, emits);
+
+    printf("%3d slots: Signal %8.1f ns/emit, FlatSignal %8.1f ns/emit (x%.2f)\n",
+      slots, list_ns, flat_ns, list_ns / flat_ns);
+  }
+
+  // handler set known at compile time
+  {
+    const int emits = 1000000;
+    Signal<void(int)> sig;
+    std::vector<Connection> conns;
+    fill(sig, conns, 4);
+    auto ssig = make_static_signal<void(int)>(slot_fn<0>{0}, slot_fn<1>{1}, slot_fn<2>{2}, slot_fn<3>{3});
+
+    bench_emit(sig, emits / 10);
+    const double list_ns = bench_emit(sig, emits);
+    bench_emit(ssig, emits / 10);
+    const double static_ns = bench_emit(ssig, emits);
+
+    printf("  4 slots: Signal %8.1f ns/emit, StaticSignal %6.1f ns/emit (x%.2f)\n",
+      list_ns, static_ns, list_ns / static_ns);
+  }
+
+  // runs of events: emit() per element vs. emit_batch() with batch handlers
+  {
+    const int run = 256, batches = 20000;
+    std::vector<int> args(run);
+    for (int i = 0; i < run; i++) {
+      args[i] = i;
+    }
+    Signal<void(int)> sig, bsig;
+    std::vector<Connection> conns;
+    fill(sig, conns, 4);
+    for (int i = 0; i < 4; i++) {
+      conns.push_back(bsig.connect_batch([i](const int *a, size_t n) {
+        for (size_t j = 0; j < n; j++) {
+          counter += (a[j] ^ i) + i;
+        }
+      }));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int k = 0; k < batches; k++) {
+      for (int i = 0; i < run; i++) {
+        sig.emit(args[i]);
+      }
+    }
+    auto mid = std::chrono::steady_clock::now();
+    for (int k = 0; k < batches; k++) {
+      bsig.emit_batch(args.data(), run);
+    }
+    auto end = std::chrono::steady_clock::now();
+    const double emit_ns = std::chrono::duration<double, std::nano>(mid - start).count() / (batches * run);
+    const double batch_ns = std::chrono::duration<double, std::nano>(end - mid).count() / (batches * run);
+
+    printf("  4 slots, runs of %d: emit %6.1f ns/element, emit_batch %6.1f ns/element (x%.2f)\n",
+      run, emit_ns, batch_ns, emit_ns / batch_ns);
+  }
+
+  // many signals (e.g. one per window): working set no longer fits into the cache
+  const int nsignals = 4096, slots = 16;
+  {
+    std::vector<std::unique_ptr<Signal<void(int)>>> sigs;
+    std::vector<std::unique_ptr<FlatSignal<void(int)>>> fsigs;
+    std::vector<Connection> conns;
+    for (int i = 0; i < nsignals; i++) {
+      sigs.emplace_back(new Signal<void(int)>);
+      fill(*sigs.back(), conns, slots);
+      fsigs.emplace_back(new FlatSignal<void(int)>);
+      fill(*fsigs.back(), conns, slots);
+    }
+
+    auto run = [&](bool flat) {
+      auto start = std::chrono::steady_clock::now();
+      for (int k = 0; k < 20; k++) {
+        for (int i = 0; i < nsignals; i++) {
+          const int j = (i * 2654435761u) % nsignals; // (not sequential)
+          if (flat) {
+            fsigs[j]->emit(i);
+          } else {
+            sigs[j]->emit(i);
+          }
+        }
+      }
+      auto end = std::chrono::steady_clock::now();
+      return std::chrono::duration<double, std::nano>(end - start).count() / (20 * nsignals);
+    };
+    run(false);
+    const double list_ns = run(false);
+    run(true);
+    const double flat_ns = run(true);
+
+    printf("%d signals x %d slots: Signal %8.1f ns/emit, FlatSignal %8.1f ns/emit (x%.2f)\n",
+      nsignals, slots, list_ns, flat_ns, list_ns / flat_ns);
+  }
+
+  // handler churn (e.g. panels opening / closing): malloc vs. SignalArena
+  {
+    SignalArena arena;
+    auto churn = [](Signal<void(int)> &sig) {
+      std::vector<Connection> conns;
+      auto start = std::chrono::steady_clock::now();
+      for (int k = 0; k < 1000; k++) {
+        for (int i = 0; i < 256; i++) {
+          conns.push_back(connect_some(sig, i));
+        }
+        for (Connection &conn : conns) {
+          conn.disconnect();
+        }
+        conns.clear();
+      }
+      auto end = std::chrono::steady_clock::now();
+      return std::chrono::duration<double, std::nano>(end - start).count() / (1000 * 256);
+    };
+    Signal<void(int)> sig, asig{&arena};
+    churn(sig);
+    const double heap_ns = churn(sig);
+    churn(asig);
+    const double arena_ns = churn(asig);
+
+    printf("connect+disconnect: malloc %6.1f ns, SignalArena %6.1f ns (x%.2f)\n",
+      heap_ns, arena_ns, heap_ns / arena_ns);
+  }
+
+  // 50000 connections (e.g. per-window handlers), kept in a vector
+  {
+    const int nconns = 50000;
+    Signal<void(int)> sig, csig;
+    std::vector<Connection> conns;
+    std::vector<CompactConnection> cconns;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nconns; i++) {
+      conns.push_back(connect_some(sig, i)); // (reallocation: pointer fix-ups)
+    }
+    auto mid = std::chrono::steady_clock::now();
+    for (int i = 0; i < nconns; i++) {
+      cconns.push_back(connect_some(csig, i));
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    printf("%d connections: Connection %zu bytes, %6.1f ns/connect; CompactConnection %zu+16 bytes, %6.1f ns/connect\n",
+      nconns,
+      sizeof(Connection), std::chrono::duration<double, std::nano>(mid - start).count() / nconns,
+      sizeof(CompactConnection), std::chrono::duration<double, std::nano>(end - mid).count() / nconns);
+  }
+
+  return (counter == 42); // (use counter)
+}
+
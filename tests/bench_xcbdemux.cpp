@@ -0,0 +1,169 @@
+#include "../xcbdemux.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+// g++ -Wall -std=c++11 -O2 -o bench_xcbdemux bench_xcbdemux.cpp `pkg-config --cflags xcb`
+
+static unsigned int counter = 0;
+
+// previous detail::signal_for_mem storage: std::unordered_map<window, Signal>
+struct MapSignalForMem {
+  template <typename Fn>
+  Connection connect(xcb_window_t win, Fn&& fn) {
+    return map[win].connect((Fn&&)fn);
+  }
+
+  void operator()(xcb_motion_notify_event_t *ev) {
+    auto it = map.find(ev->event);
+    if (it != map.end()) {
+      it->second.emit(ev);
+    }
+  }
+
+private:
+  std::unordered_map<xcb_window_t, Signal<void(xcb_motion_notify_event_t *), void, detail::reduce_void>> map;
+};
+
+struct noconnect {
+  template <typename Fn>
+  Connection operator()(Fn&) {
+    return {};
+  }
+};
+
+struct nothing {
+  void operator()() const { }
+};
+
+using FlatSignalForMem = detail::signal_for_mem<xcb_motion_notify_event_t, xcb_window_t, &xcb_motion_notify_event_t::event, noconnect, nothing>;
+
+template <typename Fn, typename EventType>
+static double bench_emit(Fn &&emit, const std::vector<EventType *> &evs, int rounds)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (EventType *ev : evs) {
+      emit(ev);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return rounds * evs.size() / std::chrono::duration<double>(end - start).count();
+}
+
+static void run(int num_windows)
+{
+  const xcb_window_t base = 0x1a00001;  // (typical XID layout: client bits on top, sequential below)
+  const int count = 65536, rounds = 50;
+
+  // events for random windows, 1/8 of them for unknown windows
+  std::vector<xcb_motion_notify_event_t> storage(count);
+  std::vector<xcb_motion_notify_event_t *> evs;
+  srand(1);
+  for (auto &ev : storage) {
+    ev.response_type = XCB_MOTION_NOTIFY;
+    ev.event = base + rand() % (num_windows + num_windows / 8);
+    ev.event_x = rand() % 100;
+    evs.push_back(&ev);
+  }
+
+  MapSignalForMem msfm;
+  FlatSignalForMem fsfm;
+  XcbDemux demux;
+  std::vector<Connection> conns;
+  for (int i = 0; i < num_windows; i++) {
+    conns.push_back(msfm.connect(base + i, [](xcb_motion_notify_event_t *ev) { counter += ev->event_x; }));
+    conns.push_back(fsfm.connect(base + i, [](xcb_motion_notify_event_t *ev) { counter += ev->event_x; }));
+    conns.push_back(demux.on_motion_notify(base + i, [](xcb_motion_notify_event_t *ev) { counter += ev->event_x; }));
+  }
+
+  bench_emit(msfm, evs, rounds / 10); // warm up
+  const double map_eps = bench_emit(msfm, evs, rounds);
+  bench_emit(fsfm, evs, rounds / 10);
+  const double flat_eps = bench_emit(fsfm, evs, rounds);
+  auto demux_emit = [&demux](xcb_motion_notify_event_t *ev) { demux.emit((xcb_generic_event_t *)ev); };
+  bench_emit(demux_emit, evs, rounds / 10);
+  const double demux_eps = bench_emit(demux_emit, evs, rounds);
+
+  printf("%6d windows: unordered_map %6.1f M events/s, flat_map %6.1f M events/s (x%.2f); XcbDemux::emit %6.1f M events/s\n",
+         num_windows, map_eps / 1e6, flat_eps / 1e6, flat_eps / map_eps, demux_eps / 1e6);
+}
+
+// widgets with several handlers: on_xxx(win, fn) each vs. one XcbWindowHandler per window
+struct Widget : XcbWindowEvents<Widget> {
+  void on_key_press(xcb_key_press_event_t *ev) { counter += ev->detail; }
+  void on_button_press(xcb_button_press_event_t *ev) { counter += ev->detail; }
+  void on_button_release(xcb_button_release_event_t *ev) { counter += ev->detail; }
+  void on_motion_notify(xcb_motion_notify_event_t *ev) { counter += ev->event_x; }
+  void on_enter_notify(xcb_enter_notify_event_t *ev) { counter++; }
+  void on_leave_notify(xcb_leave_notify_event_t *ev) { counter--; }
+  void on_expose(xcb_expose_event_t *ev) { counter += ev->width; }
+  void on_configure_notify(xcb_configure_notify_event_t *ev) { counter += ev->width; }
+};
+
+static void run_widgets(int num_windows)
+{
+  const xcb_window_t base = 0x1a00001;
+  const int count = 65536, rounds = 50;
+
+  const uint8_t mix[] = {
+    XCB_MOTION_NOTIFY, XCB_MOTION_NOTIFY, XCB_MOTION_NOTIFY, XCB_MOTION_NOTIFY, XCB_ENTER_NOTIFY, XCB_LEAVE_NOTIFY,
+    XCB_EXPOSE, XCB_KEY_PRESS, XCB_BUTTON_PRESS, XCB_BUTTON_RELEASE, XCB_CONFIGURE_NOTIFY
+  };
+  std::vector<xcb_generic_event_t> storage(count);
+  std::vector<xcb_generic_event_t *> evs;
+  srand(2);
+  for (auto &ev : storage) {
+    ev.response_type = mix[rand() % sizeof(mix)];
+    const xcb_window_t win = base + rand() % num_windows;
+    if (ev.response_type == XCB_EXPOSE || ev.response_type == XCB_CONFIGURE_NOTIFY) {
+      ((xcb_expose_event_t *)&ev)->window = win;  // (same offset in configure_notify)
+    } else {
+      ((xcb_motion_notify_event_t *)&ev)->event = win;
+    }
+    evs.push_back(&ev);
+  }
+
+  XcbDemux fdemux, wdemux;
+  std::vector<Connection> conns;
+  std::vector<Widget> widgets(num_windows);
+  for (int i = 0; i < num_windows; i++) {
+    Widget &w = widgets[i];
+    const xcb_window_t win = base + i;
+    conns.push_back(fdemux.on_key_press(win, [&w](xcb_key_press_event_t *ev) { w.on_key_press(ev); }));
+    conns.push_back(fdemux.on_button_press(win, [&w](xcb_button_press_event_t *ev) { w.on_button_press(ev); }));
+    conns.push_back(fdemux.on_button_release(win, [&w](xcb_button_release_event_t *ev) { w.on_button_release(ev); }));
+    conns.push_back(fdemux.on_motion_notify(win, [&w](xcb_motion_notify_event_t *ev) { w.on_motion_notify(ev); }));
+    conns.push_back(fdemux.on_enter_notify(win, [&w](xcb_enter_notify_event_t *ev) { w.on_enter_notify(ev); }));
+    conns.push_back(fdemux.on_leave_notify(win, [&w](xcb_leave_notify_event_t *ev) { w.on_leave_notify(ev); }));
+    conns.push_back(fdemux.on_expose(win, [&w](xcb_expose_event_t *ev) { w.on_expose(ev); }));
+    conns.push_back(fdemux.on_configure_notify(win, [&w](xcb_configure_notify_event_t *ev) { w.on_configure_notify(ev); }));
+    wdemux.attach(win, w);
+  }
+
+  auto emit_fn = [](XcbDemux &demux) {
+    return [&demux](xcb_generic_event_t *ev) { demux.emit(ev); };
+  };
+  bench_emit(emit_fn(fdemux), evs, rounds / 10);
+  const double fn_eps = bench_emit(emit_fn(fdemux), evs, rounds);
+  bench_emit(emit_fn(wdemux), evs, rounds / 10);
+  const double win_eps = bench_emit(emit_fn(wdemux), evs, rounds);
+
+  printf("%6d widgets: on_xxx(win, fn) %6.1f M events/s, attach(win, handler) %6.1f M events/s (x%.2f)\n",
+         num_windows, fn_eps / 1e6, win_eps / 1e6, win_eps / fn_eps);
+}
+
+int main()
+{
+  run(100);
+  run(10000);
+  run(100000);
+
+  run_widgets(100);
+  run_widgets(10000);
+
+  return (counter == 42) ? 1 : 0;
+}
+
@@ -0,0 +1,133 @@
+#include "../xcbevents.h"
+#include "../xcbdispatch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+// g++ -Wall -std=c++11 -O2 -o bench_xcbevents bench_xcbevents.cpp `pkg-config --cflags xcb`
+
+static unsigned int counter = 0;
+
+// previous XcbEventCallbacks routing: hash lookup -> virtual call -> Signal
+struct MapEventCallbacks {
+  template <typename EventType, typename Fn>
+  Connection on(uint8_t type, Fn&& fn) {
+    auto &res = map[type];
+    if (!res) {
+      res.reset(new TypedSignal<EventType *>);
+    }
+    return static_cast<TypedSignal<EventType *> &>(*res).signal.connect((Fn&&)fn);
+  }
+
+  void emit(xcb_generic_event_t *ev) const {
+    auto it = map.find(ev->response_type & ~0x80);
+    if (it == map.end()) {
+      return;
+    }
+    it->second->emit(ev);
+  }
+
+private:
+  struct TypedSignalBase {
+    virtual ~TypedSignalBase() = default;
+    virtual void emit(xcb_generic_event_t *ev) = 0;
+  };
+
+  template <typename EventTypePtr>
+  struct TypedSignal : TypedSignalBase {
+    void emit(xcb_generic_event_t *ev) override {
+      signal.emit((EventTypePtr)ev);
+    }
+    Signal<void(EventTypePtr), void, detail::reduce_void> signal;
+  };
+
+  std::unordered_map<uint8_t, std::unique_ptr<TypedSignalBase>> map;
+};
+
+template <typename Callbacks>
+static void connect_all(Callbacks &ecs, std::vector<Connection> &conns)
+{
+  conns.push_back(ecs.template on<xcb_motion_notify_event_t>(XCB_MOTION_NOTIFY, [](xcb_motion_notify_event_t *ev) { counter += ev->event_x; }));
+  conns.push_back(ecs.template on<xcb_motion_notify_event_t>(XCB_MOTION_NOTIFY, [](xcb_motion_notify_event_t *ev) { counter ^= ev->event_y; }));
+  conns.push_back(ecs.template on<xcb_expose_event_t>(XCB_EXPOSE, [](xcb_expose_event_t *ev) { counter += ev->width; }));
+  conns.push_back(ecs.template on<xcb_key_press_event_t>(XCB_KEY_PRESS, [](xcb_key_press_event_t *ev) { counter += ev->detail; }));
+  conns.push_back(ecs.template on<xcb_button_press_event_t>(XCB_BUTTON_PRESS, [](xcb_button_press_event_t *ev) { counter += ev->detail; }));
+  conns.push_back(ecs.template on<xcb_property_notify_event_t>(XCB_PROPERTY_NOTIFY, [](xcb_property_notify_event_t *ev) { counter += ev->atom; }));
+  conns.push_back(ecs.template on<xcb_configure_notify_event_t>(XCB_CONFIGURE_NOTIFY, [](xcb_configure_notify_event_t *ev) { counter += ev->width; }));
+}
+
+template <typename Callbacks>
+static double bench_emit(const Callbacks &ecs, const std::vector<xcb_generic_event_t *> &evs, int rounds)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (xcb_generic_event_t *ev : evs) {
+      ecs.emit(ev);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return rounds * evs.size() / std::chrono::duration<double>(end - start).count();
+}
+
+template <typename Dispatcher>
+static double bench_dispatch(Dispatcher &dispatch, const std::vector<xcb_generic_event_t *> &evs, int rounds)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (xcb_generic_event_t *ev : evs) {
+      dispatch(ev);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return rounds * evs.size() / std::chrono::duration<double>(end - start).count();
+}
+
+int main()
+{
+  // mostly motion, some unhandled types (e.g. enter/leave, focus)
+  const uint8_t mix[] = {
+    XCB_MOTION_NOTIFY, XCB_MOTION_NOTIFY, XCB_MOTION_NOTIFY, XCB_MOTION_NOTIFY, XCB_MOTION_NOTIFY, XCB_MOTION_NOTIFY,
+    XCB_EXPOSE, XCB_EXPOSE, XCB_KEY_PRESS, XCB_KEY_RELEASE, XCB_BUTTON_PRESS, XCB_BUTTON_RELEASE,
+    XCB_ENTER_NOTIFY, XCB_LEAVE_NOTIFY, XCB_FOCUS_IN, XCB_PROPERTY_NOTIFY, XCB_CONFIGURE_NOTIFY
+  };
+  const int count = 4096, rounds = 500;
+
+  std::vector<xcb_generic_event_t> storage(count);
+  std::vector<xcb_generic_event_t *> evs;
+  srand(1);
+  for (auto &ev : storage) {
+    ev.response_type = mix[rand() % sizeof(mix)] | ((rand() % 8) ? 0 : 0x80);  // (some with send_event bit)
+    evs.push_back(&ev);
+  }
+
+  MapEventCallbacks mecs;
+  XcbEventCallbacks ecs;
+  std::vector<Connection> conns;
+  connect_all(mecs, conns);
+  connect_all(ecs, conns);
+
+  bench_emit(mecs, evs, rounds / 10); // warm up
+  const double map_eps = bench_emit(mecs, evs, rounds);
+  bench_emit(ecs, evs, rounds / 10);
+  const double table_eps = bench_emit(ecs, evs, rounds);
+
+  printf("unordered_map %6.1f M events/s, table %6.1f M events/s (x%.2f)\n", map_eps / 1e6, table_eps / 1e6, table_eps / map_eps);
+
+  // same handlers, routing fixed at compile time
+  auto dispatch = make_xcb_dispatcher(
+    [](xcb_motion_notify_event_t *ev) { counter += ev->event_x; counter ^= ev->event_y; },
+    [](xcb_expose_event_t *ev) { counter += ev->width; },
+    xcb_on<XCB_KEY_PRESS>([](xcb_key_press_event_t *ev) { counter += ev->detail; }),
+    xcb_on<XCB_BUTTON_PRESS>([](xcb_button_press_event_t *ev) { counter += ev->detail; }),
+    [](xcb_property_notify_event_t *ev) { counter += ev->atom; },
+    [](xcb_configure_notify_event_t *ev) { counter += ev->width; });
+
+  bench_dispatch(dispatch, evs, rounds / 10);
+  const double static_eps = bench_dispatch(dispatch, evs, rounds);
+  printf("XcbStaticDispatcher %6.1f M events/s (x%.2f vs. table)\n", static_eps / 1e6, static_eps / table_eps);
+
+  return (counter == 42) ? 1 : 0;
+}
+
@@ -1,6 +1,9 @@
 #include "../signals.h"
+#include "../signals-stats.h"
+#include "../signals-flat.h"
 //#include "../signals-listloop.h"
 #include <stdio.h>
+#include <string>
 
 // g++ -Wall -std=c++11 -o test_signals test_signals.cpp
 
@@ -20,9 +23,93 @@ struct foo {
   Connection conn;
 };
 
+// a handler that disconnects itself must still be able to use its captures; a once-handler is not called again by nested emits
+static void flat_self_disconnect()
+{
+  FlatSignal<void(int)> sig;
+  Connection conn;
+  std::string name = "self-disconnecting"; // (too large for the inline storage)
+  conn = sig.append([&conn, name](int i) {
+    conn.disconnect();
+    printf("%s %d\n", name.c_str(), i);
+  });
+  sig.append([&sig](int i) {
+    if (i == 1) {
+      sig.emit(2);
+    }
+  }, true);
+  sig.append([](int i) { printf("flat %d\n", i); });
+  sig.emit(1); // self-disconnecting 1, flat 2, flat 1
+  sig.emit(3); // flat 3
+  printf("%d\n", conn.connected());
+}
+
+// disconnect / clear during emit
+static void disconnect_during_emit()
+{
+  Signal<void(int)> sig;
+  Connection conn1, conn2;
+  conn1 = sig.append([&](int i) {
+    printf("a %d\n", i);
+    conn1.disconnect();
+    conn2.disconnect();
+  });
+  conn2 = sig.append([](int i) { printf("b %d\n", i); }); // not called
+  sig.append([&sig](int i) {
+    printf("c %d\n", i);
+    if (i == 3) {
+      sig.emit(4);
+      sig.clear();
+    }
+  });
+
+  sig.emit(3); // a 3, c 3, c 4
+  sig.emit(5); // nothing
+  printf("%d %d %d\n", conn1.connected(), conn2.connected(), sig.empty()); // 0 0 1
+}
+
+// block / unblock
+static void block_unblock()
+{
+  Signal<void(int)> sig;
+  auto conn = sig.append([](int i) { printf("a %d\n", i); });
+  sig.append([](int i) { printf("b %d\n", i); });
+
+  {
+    ConnectionBlocker blocker(conn);
+    sig.emit(1); // only b
+    printf("%d %d\n", conn.blocked(), conn.connected()); // 1 1
+  }
+  sig.emit(2); // a, b
+}
+
+// instrumentation
+static void instrumentation()
+{
+  Signal<void(int), void, detail::reduce_void, SignalStats> sig;
+  auto conn = sig.append([](int i) { printf("a %d\n", i); });
+  sig.append([](int i) { printf("b %d\n", i); });
+  for (int i = 0; i < 3; i++) {
+    sig.emit(i);
+  }
+
+  auto snap = sig.instrument().snapshot();
+  printf("emits %llu, calls %llu, slots %zu, slot a called %llu times\n", // 3, 6, 2, 3
+         (unsigned long long)snap.emits, (unsigned long long)snap.calls, snap.slots.size(),
+         (unsigned long long)sig.instrument().slot(conn)->count);
+  sig.instrument().reset();
+  printf("%d\n", !sig.instrument().slot(conn)); // 1
+
+  printf("%zu %zu\n", sizeof(Signal<void(int)>), sizeof(sig));
+}
 
 int main()
 {
+  flat_self_disconnect();
+  disconnect_during_emit();
+  block_unblock();
+  instrumentation();
+
 #if 0
 //std::unique_ptr<Connection> conn2;
   Signal<void(int)> sig;
@@ -68,7 +155,7 @@ sig.emit(3);
 
 #else
 Signal<void(int)> sig2;
-  Signal<bool(int), void, detail::reduce_stop_on_true> sig;
+  Signal<bool(int), void, detail::reduce_consumed> sig;
   sig.append([](int i) {
     printf("x1 %d\n", i);
 
@@ -0,0 +1,138 @@
+#include "../signals-concurrent.h"
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// g++ -Wall -std=c++11 -O2 -pthread -o test_signals_concurrent test_signals_concurrent.cpp
+
+// emitters keep running, while one thread connects / disconnects
+static bool stress(int nemitters)
+{
+  ConcurrentSignal<void(int)> sig;
+  std::atomic<bool> stop{false};
+  std::atomic<long> calls{0}, once_calls{0};
+
+  ConcurrentConnection fixed = sig.connect([&](int) { calls.fetch_add(1, std::memory_order_relaxed); });
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < nemitters; i++) {
+    threads.emplace_back([&] {
+      while (!stop.load()) {
+        sig.emit(1);
+      }
+    });
+  }
+
+  const int rounds = 20000;
+  std::vector<ConcurrentConnection> conns;
+  for (int k = 0; k < rounds; k++) {
+    conns.push_back(sig.connect([&](int) { calls.fetch_add(1, std::memory_order_relaxed); }, (k & 1) ? SIGNAL_PREPEND : SIGNAL_DEFAULT));
+    sig.connect([&](int) { once_calls.fetch_add(1); }, SIGNAL_ONCE);
+    if (conns.size() > 8) {
+      conns[k % conns.size()].disconnect();
+      conns.erase(conns.begin() + k % conns.size());
+    }
+    if (k % 1000 == 0) {
+      sig.clear();
+      conns.clear();
+      fixed = sig.connect([&](int) { calls.fetch_add(1, std::memory_order_relaxed); });
+    }
+  }
+
+  stop = true;
+  for (std::thread &t : threads) {
+    t.join();
+  }
+  sig.emit(0); // (remaining once handlers)
+
+  printf("stress %d emitters: %ld calls, %ld once (max %d)\n", nemitters, calls.load(), once_calls.load(), rounds);
+  return fixed.connected() && once_calls.load() <= rounds;
+}
+
+template <typename EmitFn>
+static double throughput(int nthreads, EmitFn emit)
+{
+  const int emits = 1000000;
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < nthreads; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < emits; j++) {
+        emit(j);
+      }
+    });
+  }
+  for (std::thread &t : threads) {
+    t.join();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return nthreads * emits / std::chrono::duration<double, std::micro>(end - start).count(); // emits / us
+}
+
+int main()
+{
+  bool ok = true;
+  ok &= stress(1);
+  ok &= stress(4);
+
+  // handlers that return values / remove themselves
+  {
+    ConcurrentSignal<int(int), detail::reduce_use_last<int>> sig;
+    std::atomic<int> n{0};
+    ConcurrentConnection conn = sig.connect([&](int i) { n++; return i; });
+    sig.connect([&](int i) { n++; return i * 2; }, SIGNAL_ONCE);
+    ok &= (sig.emit(3) == 6) && (sig.emit(4) == 4) && (n == 3);
+    conn.disconnect();
+    ok &= !conn.connected() && sig.empty() && (sig.emit(5) == 0);
+  }
+
+  // disconnected handlers are destroyed once no emit can still use them, not only on the next connect / disconnect
+  {
+    static int alive = 0;
+    struct tracked {
+      tracked() { alive++; }
+      tracked(const tracked &) { alive++; }
+      ~tracked() { alive--; }
+    };
+    ConcurrentSignal<void(int)> sig;
+    ConcurrentConnection conn;
+    tracked t;
+    conn = sig.connect([&conn, t](int) { conn.disconnect(); }); // (still running when retired)
+    sig.connect([](int) { }, SIGNAL_ONCE);
+    sig.emit(1);
+    ok &= (alive == 1) && !conn.connected();
+
+    ConcurrentSignal<void(int)> *sig2 = new ConcurrentSignal<void(int)>;
+    sig2->connect([t](int) { });
+    delete sig2;
+    ok &= (alive == 1);
+  }
+
+  // 4 handlers: ConcurrentSignal vs. Signal with a mutex
+  const int nthreads[] = {1, 2, 4, 8};
+  for (int n : nthreads) {
+    static thread_local unsigned int counter;
+    ConcurrentSignal<void(int)> csig;
+    Signal<void(int)> sig;
+    std::mutex mutex;
+    std::vector<ConcurrentConnection> cconns;
+    std::vector<Connection> conns;
+    for (int i = 0; i < 4; i++) {
+      cconns.push_back(csig.connect([i](int j) { counter += i ^ j; }));
+      conns.push_back(sig.connect([i](int j) { counter += i ^ j; }));
+    }
+
+    const double concurrent = throughput(n, [&](int j) { csig.emit(j); });
+    const double locked = throughput(n, [&](int j) {
+      std::lock_guard<std::mutex> lock(mutex);
+      sig.emit(j);
+    });
+    printf("%d threads: ConcurrentSignal %7.1f Memits/s, Signal+mutex %7.1f Memits/s\n", n, concurrent, locked);
+  }
+
+  printf("%s\n", (ok) ? "ok" : "FAILED");
+  return !ok;
+}
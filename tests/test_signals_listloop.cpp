@@ -0,0 +1,43 @@
+#include "../signals-listloop.h"
+#include <stdio.h>
+
+// g++ -Wall -std=c++11 -o test_signals_listloop test_signals_listloop.cpp
+
+using detail::reduce_result_t;
+
+int main()
+{
+  bool ok = true;
+
+  // void handlers may stop the emit or remove themselves
+  {
+    Signal<void(int)> sig;
+    int a = 0, b = 0, c = 0;
+    sig.connect([&a](int) { a++; return reduce_result_t::REMOVE_HANDLER; });
+    sig.connect([&b](int i) { b++; return (i == 1) ? reduce_result_t::STOP : reduce_result_t::CONTINUE; });
+    sig.connect([&c](int) { c++; });
+    sig.emit(1);  // a b
+    sig.emit(2);  // b c
+    printf("void: %d %d %d (expected 1 2 1)\n", a, b, c);
+    ok &= (a == 1 && b == 2 && c == 1);
+  }
+
+  // short-circuiting reducers
+  {
+    int calls = 0;
+    Signal<bool(int), void, detail::reduce_consumed> sig;
+    sig.connect([&calls](int i) { calls++; return i > 0; });
+    sig.connect([&calls](int) { calls++; return true; });
+    const bool consumed = sig.emit(1), fallthrough = sig.emit(-1);
+    printf("consumed: %d %d, %d calls (expected 1 1, 3)\n", consumed, fallthrough, calls);
+    ok &= consumed && fallthrough && calls == 3;
+
+    Signal<bool(int), void, detail::reduce_all> all;
+    ok &= all.emit(0);  // (no handlers)
+    all.connect([](int i) { return i != 0; });
+    ok &= all.emit(1) && !all.emit(0);
+  }
+
+  printf("%s\n", (ok) ? "ok" : "FAILED");
+  return !ok;
+}
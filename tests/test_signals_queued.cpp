@@ -0,0 +1,88 @@
+#include "../signals.h"
+#include "../signals-queued.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <string>
+
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+  allocations++;
+  if (void *ret = malloc(size ? size : 1)) {
+    return ret;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+  free(ptr);
+}
+
+// g++ -Wall -std=c++11 -o test_signals_queued test_signals_queued.cpp
+
+int main()
+{
+  EmitQueue queue;
+  Signal<void(int)> sig1;
+  Signal<void(int, const char *)> sig2;
+
+  Connection c1 = sig1.connect([&](int x) {
+    printf("sig1 %d\n", x);
+    if (x == 1) {
+      queue.post(sig1, 100);   // runs in the same dispatch(), after the current round
+      queue.cancel(sig2);      // drops the pending sig2 emit
+    }
+  });
+  sig2.connect([](int x, const char *str) {
+    printf("sig2 %d %s\n", x, str);
+  });
+
+  queue.post(sig1, 1);
+  for (int i = 0; i < 5; i++) {
+    queue.post_coalesced(sig1, 10 + i);  // only 14 remains (at the position of 10)
+  }
+  queue.post_coalesced(7, sig1, 20);
+  queue.post_coalesced(7, sig1, 21);
+  queue.post_coalesced(8, sig1, 30);
+  queue.cancel(8, sig1);
+  queue.post(sig2, 2, "dropped");
+
+  printf("dispatched %zu\n", queue.dispatch());  // 1 14 21 100 -> 4
+  printf("empty %d\n", queue.empty());
+
+  queue.post(sig2, 3, "second");
+  printf("dispatched %zu\n", queue.dispatch());
+
+  // dispatch() from a handler does nothing, the outer one runs the emit
+  c1.disconnect();
+  c1 = sig1.connect([&](int x) {
+    printf("sig1 %d, nested dispatched %zu\n", x, queue.dispatch());
+    if (x == 40) {
+      queue.post(sig1, 41);
+    }
+  });
+  queue.post(sig1, 40);
+  printf("dispatched %zu\n", queue.dispatch());  // 40 41 -> 2
+
+  // arguments are stored by value; once warmed up, posting does not allocate
+  c1.disconnect();
+  Signal<void(const std::string &)> sig3;
+  sig3.connect([](const std::string &str) {
+    printf("sig3 %s\n", str.c_str());
+  });
+  queue.post(sig3, std::string("stored"));
+  queue.dispatch();
+  for (int i = 0; i < 100; i++) {
+    queue.post(sig1, i);
+  }
+  queue.dispatch();
+  const size_t before = allocations;
+  for (int i = 0; i < 100; i++) {
+    queue.post(sig1, i);
+  }
+  queue.dispatch();
+  printf("allocations %zu\n", allocations - before);  // 0
+
+  return 0;
+}
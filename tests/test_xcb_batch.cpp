@@ -0,0 +1,118 @@
+#include "xcb_stubs.h"
+#include <stdio.h>
+#include <map>
+
+// g++ -Wall -std=c++11 -o test_xcb_batch test_xcb_batch.cpp ../xcb_base.cpp `pkg-config --cflags --libs xcb`
+// (no X server needed: the xcb functions used are replaced below and in xcb_stubs.h)
+
+static int round_trips = 0;
+static unsigned int completed = 0;  // (replies up to here have arrived)
+static std::map<unsigned int, uint8_t> errors;  // sequence -> error_code, for requests that fail
+static uint32_t bad_drawable = 0xbad;
+
+extern "C" {
+xcb_void_cookie_t xcb_create_gc_checked(xcb_connection_t *, xcb_gcontext_t, xcb_drawable_t drawable, uint32_t, const void *) {
+  const unsigned int seq = request();
+  if (drawable == bad_drawable) {
+    errors[seq] = XCB_DRAWABLE;
+  }
+  return {seq};
+}
+xcb_void_cookie_t xcb_change_gc_checked(xcb_connection_t *, xcb_gcontext_t, uint32_t value_mask, const void *) {
+  const unsigned int seq = request();
+  if (value_mask == XCB_GC_FONT) {
+    errors[seq] = XCB_FONT;
+  }
+  return {seq};
+}
+xcb_void_cookie_t xcb_free_gc(xcb_connection_t *, xcb_gcontext_t) { return {request()}; }
+
+xcb_get_input_focus_cookie_t xcb_get_input_focus(xcb_connection_t *) { return {request()}; }
+xcb_get_input_focus_reply_t *xcb_get_input_focus_reply(xcb_connection_t *, xcb_get_input_focus_cookie_t, xcb_generic_error_t **) {
+  round_trips++;
+  completed = sequence;
+  return (xcb_get_input_focus_reply_t *)calloc(1, sizeof(xcb_get_input_focus_reply_t));
+}
+
+xcb_generic_error_t *xcb_request_check(xcb_connection_t *, xcb_void_cookie_t cookie) {
+  if (cookie.sequence > completed) { // (as xcb: sync, unless a later reply has already arrived)
+    round_trips++;
+    completed = sequence;
+  }
+  auto it = errors.find(cookie.sequence);
+  if (it == errors.end()) {
+    return NULL;
+  }
+  auto *err = (xcb_generic_error_t *)calloc(1, sizeof(xcb_generic_error_t));
+  err->error_code = it->second;
+  err->full_sequence = cookie.sequence;
+  errors.erase(it);
+  return err;
+}
+}
+
+int main() {
+  XcbConnection &conn = stub_connection();
+
+  // immediate: one round trip per call
+  round_trips = 0;
+  for (int i = 0; i < 10; i++) {
+    XcbGC gc(conn, 1);
+    gc.change(XCB_GC_FOREGROUND, {0});
+  }
+  printf("immediate: %d round trips (expected 20)\n", round_trips);
+
+  try {
+    XcbGC gc(conn, bad_drawable);
+  } catch (const XcbGenericError &err) {
+    printf("thrown: %s\n", err.what());
+  }
+
+  // batched: one round trip in total
+  round_trips = 0;
+  {
+    XcbRequestBatch batch(conn);
+    for (int i = 0; i < 10; i++) {
+      XcbGC gc(conn, 1);
+      gc.change(XCB_GC_FOREGROUND, {0});
+    }
+    printf("collected %zu requests\n", batch.size());
+    batch.check();
+  }
+  printf("batched: %d round trips (expected 1)\n", round_trips);
+
+  // the first error is thrown (attributed to its call), further ones are logged
+  try {
+    XcbRequestBatch batch(conn);
+    XcbGC gc1(conn, 1);
+    XcbGC gc2(conn, bad_drawable);
+    gc1.change(XCB_GC_FONT, {0});
+    batch.check();
+  } catch (const XcbGenericError &err) {
+    printf("thrown: %s\n", err.what());
+  }
+
+  // with fn: every error is reported, nothing is thrown; also at the end of the scope
+  {
+    XcbRequestBatch batch(conn, [](const char *what, const xcb_generic_error_t *err) {
+      printf("reported: %s, error %d, seq %u\n", what, err->error_code, err->full_sequence);
+    });
+    XcbGC gc1(conn, bad_drawable);
+    gc1.change(XCB_GC_FONT, {0});
+  }
+
+  // nested batches: the inner one only checks its own requests
+  {
+    XcbRequestBatch outer(conn);
+    XcbGC gc1(conn, 1);
+    {
+      XcbRequestBatch inner(conn);
+      XcbGC gc2(conn, 1);
+      printf("inner %zu, outer %zu (expected 1, 1)\n", inner.size(), outer.size());
+    }
+    XcbGC gc3(conn, 1);
+    printf("outer %zu (expected 2)\n", outer.size());
+  }
+
+  return 0;
+}
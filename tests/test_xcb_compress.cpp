@@ -0,0 +1,73 @@
+#include "xcb_stubs.h"
+#include <stdio.h>
+
+// g++ -Wall -std=c++11 -o test_xcb_compress test_xcb_compress.cpp ../xcb_base.cpp `pkg-config --cflags --libs xcb`
+// (no X server needed: the xcb event functions are replaced, cf. xcb_stubs.h)
+
+static xcb_generic_event_t *mk(uint8_t type, uint32_t win, uint16_t state, int16_t x) {
+  auto *ev = (xcb_generic_event_t *)calloc(1, sizeof(xcb_generic_event_t));
+  ev->response_type = type;
+  if (type == XCB_MOTION_NOTIFY) {
+    auto *m = (xcb_motion_notify_event_t *)ev; m->event = win; m->state = state; m->event_x = x;
+  } else if (type == XCB_CONFIGURE_NOTIFY) {
+    auto *c = (xcb_configure_notify_event_t *)ev; c->event = c->window = win; c->width = x;
+  }
+  return ev;
+}
+
+int main() {
+  XcbConnection &conn = stub_connection();
+  for (int pass = 0; pass < 2; pass++) {
+    conn.set_compression(pass ? XcbConnection::COMPRESS_MOTION | XcbConnection::COMPRESS_CONFIGURE : XcbConnection::COMPRESS_NONE);
+    q_socket = { mk(XCB_MOTION_NOTIFY, 1, 0, 1), mk(XCB_MOTION_NOTIFY, 1, 0, 2), mk(XCB_MOTION_NOTIFY, 1, 0x100, 3),
+                 mk(XCB_CONFIGURE_NOTIFY, 2, 0, 10), mk(XCB_MOTION_NOTIFY, 1, 0x100, 4), mk(XCB_CONFIGURE_NOTIFY, 3, 0, 30),
+                 mk(XCB_CONFIGURE_NOTIFY, 2, 0, 11), mk(XCB_MOTION_NOTIFY, 2, 0, 5), mk(XCB_MOTION_NOTIFY, 1, 0, 6) };
+    conn.run_once([](xcb_generic_event_t *ev) {
+      if (ev->response_type == XCB_MOTION_NOTIFY) printf("motion %d\n", ((xcb_motion_notify_event_t *)ev)->event_x);
+      else printf("configure %d\n", ((xcb_configure_notify_event_t *)ev)->width);
+      return true;
+    });
+    printf("-- merged motion %llu, configure %llu; socket reads %d\n", (unsigned long long)conn.compression_stats().motion_merged,
+           (unsigned long long)conn.compression_stats().configure_merged, socket_reads);
+  }
+
+  // stall: two ConfigureNotify each for many windows, only the last one per window remains
+  conn.set_compression(XcbConnection::COMPRESS_CONFIGURE);
+  conn.reset_compression_stats();
+  for (int i = 0; i < 2000; i++) {
+    q_socket.push_back(mk(XCB_CONFIGURE_NOTIFY, 100 + i % 1000, 0, i));
+  }
+  int configures = 0, last_width = 0;
+  conn.run_once([&](xcb_generic_event_t *ev) {
+    configures++;
+    last_width = ((xcb_configure_notify_event_t *)ev)->width;
+    return true;
+  });
+  printf("-- stall: %d configures (expected 1000), merged %llu, last %d\n", configures,
+         (unsigned long long)conn.compression_stats().configure_merged, last_width);
+
+  // batched drain: one read, then the queued events in batches of (here) 4
+  conn.set_compression(XcbConnection::COMPRESS_NONE);
+  conn.set_batch_limit(4);
+  for (int i = 0; i < 10; i++) {
+    q_socket.push_back(mk(XCB_MOTION_NOTIFY, 1, 0, i));
+  }
+  read_attempts = 0;
+  conn.run_batch_once([](xcb_generic_event_t *const *evs, size_t n) {
+    printf("batch of %zu:", n);
+    for (size_t i = 0; i < n; i++) printf(" %d", ((xcb_motion_notify_event_t *)evs[i])->event_x);
+    printf("\n");
+    return true;
+  });
+  printf("-- read attempts %d (expected 1)\n", read_attempts);
+
+  // an error ends the batch, and is handled by the next one (default: logged, with set_error_handler(nullptr): thrown)
+  q_socket = { mk(XCB_MOTION_NOTIFY, 1, 0, 1), mk(XCB_MOTION_NOTIFY, 1, 0, 2), mk(0, 0, 0, 0), mk(XCB_MOTION_NOTIFY, 1, 0, 3) };
+  auto print_batch = [](xcb_generic_event_t *const *evs, size_t n) { printf("batch of %zu\n", n); return true; };
+  try {
+    conn.run_batch_once(print_batch);
+  } catch (const XcbGenericError &err) {
+    printf("error: %s\n", err.what());
+  }
+  conn.run_batch_once(print_batch);
+}
@@ -0,0 +1,72 @@
+#include "xcb_stubs.h"
+#include <stdio.h>
+
+// g++ -Wall -std=c++11 -o test_xcb_errors test_xcb_errors.cpp ../xcb_base.cpp `pkg-config --cflags --libs xcb`
+// (no X server needed: the xcb functions used are replaced, cf. xcb_stubs.h)
+
+static xcb_generic_event_t *mk_error(unsigned int seq, uint8_t code) {
+  auto *err = (xcb_generic_error_t *)calloc(1, sizeof(xcb_generic_event_t));
+  err->response_type = 0;
+  err->error_code = code;
+  err->sequence = seq;
+  err->full_sequence = seq;
+  return (xcb_generic_event_t *)err;
+}
+
+static xcb_generic_event_t *mk_event(unsigned int seq) {
+  auto *ev = (xcb_generic_event_t *)calloc(1, sizeof(xcb_generic_event_t));
+  ev->response_type = XCB_PROPERTY_NOTIFY;
+  ev->full_sequence = seq;
+  return ev;
+}
+
+extern "C" {
+xcb_void_cookie_t xcb_no_operation(xcb_connection_t *) { return {request()}; }
+xcb_generic_error_t *xcb_request_check(xcb_connection_t *, xcb_void_cookie_t) { return NULL; }
+}
+
+int main() {
+  XcbConnection &conn = stub_connection();
+  auto print_event = [](xcb_generic_event_t *ev) { printf("event %u\n", ev->full_sequence); return true; };
+
+  const unsigned int r1 = request();  // default handler
+  const unsigned int r2 = request();
+  conn.on_error({r2}, [](const xcb_generic_error_t *err) { printf("r2: error %d\n", err->error_code); });
+  unsigned int r3, r4;
+  {
+    XcbErrorScope scope(conn, [](const xcb_generic_error_t *err) { printf("scope: error %d, seq %u\n", err->error_code, err->full_sequence); });
+    r3 = request();
+    r4 = request();
+  }
+  const unsigned int r5 = request();
+
+  // errors arrive later, asynchronously
+  q_read = { mk_error(r1, XCB_WINDOW), mk_event(r1), mk_error(r2, XCB_VALUE), mk_error(r3, XCB_MATCH), mk_error(r4, XCB_WINDOW),
+             mk_event(r4), mk_error(r5, XCB_DRAWABLE), mk_event(r5) };
+  conn.run_once(print_event);
+
+  // routes are also dropped after a round trip - except those with an error still in the queue
+  const unsigned int r6 = request();
+  conn.on_error({r6}, [](const xcb_generic_error_t *err) { printf("r6: error %d\n", err->error_code); });
+  const unsigned int r7 = request();
+  conn.on_error({r7}, [](const xcb_generic_error_t *err) { printf("r7: error %d\n", err->error_code); });
+  q_read = { mk_error(r7, XCB_VALUE) };
+  conn.check_request({request()}, "round trip");
+  printf("routes: %zu (expected 1)\n", conn.error_route_count());
+  conn.run_once(print_event);
+  conn.check_request({request()}, "round trip");
+  printf("routes: %zu (expected 0)\n", conn.error_route_count());
+
+  // previous behaviour: the event loop throws
+  conn.set_error_handler(nullptr);
+  q_read = { mk_event(r5), mk_error(request(), XCB_ATOM), mk_event(sequence) };
+  try {
+    conn.run_once(print_event);
+  } catch (const XcbGenericError &err) {
+    printf("thrown: %s\n", err.what());
+  }
+  conn.run_once(print_event);
+
+  return 0;
+}
+
@@ -0,0 +1,86 @@
+#include <xcb/randr.h>   // (before xcbevents.h: enables the mappings)
+#include <xcb/xfixes.h>
+#include <xcb/xinput.h>
+#include "../xcbevents.h"
+#include <stdio.h>
+#include <string.h>
+
+// g++ -Wall -std=c++11 -o test_xcb_extensions test_xcb_extensions.cpp `pkg-config --cflags --libs xcb xcb-randr xcb-xfixes xcb-xinput`
+// (no X server needed: the extension data is replaced below; xcb-xinput only for xcb_input_id)
+
+extern "C" {
+// randr at first_event 89, xfixes at 87, xinput (XGE) with major opcode 131
+const xcb_query_extension_reply_t *xcb_get_extension_data(xcb_connection_t *, xcb_extension_t *ext) {
+  static xcb_query_extension_reply_t randr, xfixes, input, absent;
+  randr.present = xfixes.present = input.present = 1;
+  randr.first_event = 89;
+  xfixes.first_event = 87;
+  input.major_opcode = 131;
+  if (ext == &xcb_randr_id) return &randr;
+  if (ext == &xcb_xfixes_id) return &xfixes;
+  if (ext == &xcb_input_id) return &input;
+  return &absent;
+}
+void xcb_prefetch_extension_data(xcb_connection_t *, xcb_extension_t *) { }
+}
+
+int main()
+{
+  XcbExtensions exts((xcb_connection_t *)1);
+  exts.prefetch<XcbRandr, XcbXfixes, XcbInput2>();
+  XcbEventCallbacks ecs;
+
+  ecs.on_ext<XcbRandr, XCB_RANDR_SCREEN_CHANGE_NOTIFY>(exts, [](xcb_randr_screen_change_notify_event_t *ev) {
+    printf("randr screen change %dx%d\n", ev->width, ev->height);
+  });
+  ecs.on_ext<XcbRandr, XCB_RANDR_NOTIFY>(exts, [](xcb_randr_notify_event_t *ev) {
+    printf("randr notify, subCode %d\n", ev->subCode);
+  });
+  ecs.on_ext<XcbXfixes, XCB_XFIXES_SELECTION_NOTIFY>(exts, [](xcb_xfixes_selection_notify_event_t *ev) {
+    printf("xfixes selection notify, owner 0x%x\n", ev->owner);
+  });
+  ecs.on_ext<XcbXfixes, XCB_XFIXES_CURSOR_NOTIFY>(exts, [](xcb_xfixes_cursor_notify_event_t *ev) {
+    printf("xfixes cursor notify, serial %u\n", ev->cursor_serial);
+  });
+  ecs.on_ext<XcbInput2, XCB_INPUT_MOTION>(exts, [](xcb_input_motion_event_t *ev) {
+    printf("xinput motion, deviceid %d\n", ev->deviceid);
+  });
+
+  xcb_randr_screen_change_notify_event_t ev1;
+  memset(&ev1, 0, sizeof(ev1));
+  ev1.response_type = 89 + XCB_RANDR_SCREEN_CHANGE_NOTIFY;
+  ev1.width = 640;
+  ev1.height = 480;
+  ecs.emit((xcb_generic_event_t *)&ev1);
+
+  xcb_randr_notify_event_t ev2;
+  memset(&ev2, 0, sizeof(ev2));
+  ev2.response_type = 89 + XCB_RANDR_NOTIFY;
+  ev2.subCode = XCB_RANDR_NOTIFY_OUTPUT_CHANGE;
+  ecs.emit((xcb_generic_event_t *)&ev2);
+
+  xcb_xfixes_selection_notify_event_t ev3;
+  memset(&ev3, 0, sizeof(ev3));
+  ev3.response_type = 87 + XCB_XFIXES_SELECTION_NOTIFY;
+  ev3.owner = 0x123;
+  ecs.emit((xcb_generic_event_t *)&ev3);
+
+  xcb_xfixes_cursor_notify_event_t ev4;
+  memset(&ev4, 0, sizeof(ev4));
+  ev4.response_type = 87 + XCB_XFIXES_CURSOR_NOTIFY;
+  ev4.cursor_serial = 42;
+  ecs.emit((xcb_generic_event_t *)&ev4);
+
+  xcb_input_motion_event_t ev5;
+  memset(&ev5, 0, sizeof(ev5));
+  ev5.response_type = XCB_GE_GENERIC;
+  ev5.extension = 131;
+  ev5.event_type = XCB_INPUT_MOTION;
+  ev5.deviceid = 2;
+  ecs.emit((xcb_generic_event_t *)&ev5);
+
+  ev5.event_type = XCB_INPUT_KEY_PRESS;
+  ecs.emit((xcb_generic_event_t *)&ev5); // nothing
+
+  return 0;
+}
@@ -0,0 +1,73 @@
+#include "xcb_stubs.h"
+#include <stdio.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// g++ -Wall -std=c++11 -o test_xcb_flush test_xcb_flush.cpp ../xcb_base.cpp `pkg-config --cflags --libs xcb`
+// (no X server needed: the xcb functions used are replaced below and in xcb_stubs.h)
+
+extern "C" {
+xcb_void_cookie_t xcb_create_gc_checked(xcb_connection_t *, xcb_gcontext_t, xcb_drawable_t, uint32_t, const void *) { return {request()}; }
+xcb_void_cookie_t xcb_free_gc(xcb_connection_t *, xcb_gcontext_t) { return {request()}; }
+xcb_generic_error_t *xcb_request_check(xcb_connection_t *, xcb_void_cookie_t) { return NULL; }
+}
+
+static void destroy_gcs(XcbConnection &conn, int n) {
+  std::vector<std::unique_ptr<XcbGC>> gcs;
+  for (int i = 0; i < n; i++) {
+    gcs.emplace_back(new XcbGC(conn, 1));
+  }
+  writes = 0;
+  gcs.clear();
+}
+
+int main() {
+  XcbConnection &conn = stub_connection();
+  auto no_events = [](xcb_generic_event_t *) { return true; };
+
+  destroy_gcs(conn, 100);
+  printf("immediate: %d writes (expected 100)\n", writes);
+
+  conn.set_flush_policy(XcbConnection::FLUSH_DEFERRED);
+  destroy_gcs(conn, 100);
+  printf("deferred: %d writes before the loop (expected 0)\n", writes);
+  conn.run_once(no_events);
+  printf("deferred: %d writes after the loop (expected 1)\n", writes);
+  conn.run_once(no_events);
+  printf("deferred: %d writes, nothing new (expected 1)\n", writes);
+
+  conn.set_flush_policy(XcbConnection::FLUSH_LATENCY, std::chrono::milliseconds(10));
+  destroy_gcs(conn, 100);
+  printf("latency: %d writes within budget (expected 0)\n", writes);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  destroy_gcs(conn, 1);
+  printf("latency: %d writes after budget (expected 1)\n", writes);
+
+  // ... also checked after each event of a long drain, i.e. not only at the next flush_soon()
+  XcbGC(conn, 1);
+  writes = 0;
+  for (int i = 0; i < 2; i++) {
+    xcb_generic_event_t *ev = (xcb_generic_event_t *)calloc(1, sizeof(xcb_generic_event_t));
+    ev->response_type = XCB_MAP_NOTIFY;
+    q_read.push_back(ev);
+  }
+  int handled = 0, writes_at_second = -1;
+  conn.run_once([&](xcb_generic_event_t *) {
+    if (handled++ == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    } else {
+      writes_at_second = writes;
+    }
+    return true;
+  });
+  printf("latency: %d writes before the second event (expected 1)\n", writes_at_second);
+
+  // switching back writes what is still due
+  XcbGC(conn, 1);
+  writes = 0;
+  conn.set_flush_policy(XcbConnection::FLUSH_IMMEDIATE);
+  printf("immediate again: %d writes (expected 1)\n", writes);
+
+  return 0;
+}
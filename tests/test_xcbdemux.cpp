@@ -1,4 +1,5 @@
 #include "../xcbdemuxwm.h"
+#include <vector>
 
 // g++ -Wall -std=c++11 -o test_xcbdemux test_xcbdemux.cpp `pkg-config --cflags xcb`
 
@@ -50,6 +51,134 @@ int main()
 //  xcb_client_message_event_t kcm = { .response_type = XCB_CLIENT_MESSAGE, .type = XCB_ATOM_NONE, .data = { .data32 = { XCB_ATOM_NONE + 0 } } };
   xcb_client_message_event_t kcm = { .response_type = XCB_CLIENT_MESSAGE, .window = 12, .type = XCB_ATOM_NONE, .data = { .data32 = { XCB_ATOM_NONE + 0 } } };
   dmux.emit((xcb_generic_event_t*)&kcm);
+
+  // Expose series: one callback per window
+  Connection dc = dmux.on_damage(7, [](xcb_window_t win, const XcbDamageRegion &damage) {
+    printf("damage %d: %zu rects, bounds %d,%d %dx%d\n", win, damage.rects.size(),
+           damage.bounds.x, damage.bounds.y, damage.bounds.width, damage.bounds.height);
+  });
+
+  xcb_expose_event_t exp[] = {
+    { .response_type = XCB_EXPOSE, .window = 7, .x = 0, .y = 0, .width = 10, .height = 10, .count = 2 },
+    { .response_type = XCB_EXPOSE, .window = 8, .x = 0, .y = 0, .width = 10, .height = 10, .count = 0 },  // (no handler)
+    { .response_type = XCB_EXPOSE, .window = 7, .x = 2, .y = 2, .width = 5, .height = 5, .count = 1 },     // (contained)
+    { .response_type = XCB_EXPOSE, .window = 7, .x = 20, .y = 0, .width = 10, .height = 30, .count = 0 }
+  };
+  for (auto &ev : exp) {
+    dmux.emit((xcb_generic_event_t*)&ev);
+  }
+
+  // incomplete series: flush_damage(), e.g. when the queue is drained
+  exp[0].count = 5;
+  dmux.emit((xcb_generic_event_t*)&exp[0]);
+  printf("flush\n");
+  dmux.flush_damage();
+  dc.disconnect();
+
+  // many windows (flat_map grows / shifts entries on erase)
+  {
+    int calls = 0;
+    std::vector<Connection> conns;
+    for (xcb_window_t win = 0x400000; win < 0x400000 + 1000; win++) {
+      conns.push_back(dmux.on_motion_notify(win, [&calls, win](xcb_motion_notify_event_t *ev) {
+        if (ev->event == win) {
+          calls++;
+        }
+      }));
+    }
+    for (size_t i = 0; i < conns.size(); i += 2) {
+      conns[i].disconnect();
+    }
+    xcb_motion_notify_event_t mne = { .response_type = XCB_MOTION_NOTIFY };
+    for (xcb_window_t win = 0x400000; win < 0x400000 + 1000; win++) {
+      mne.event = win;
+      dmux.emit((xcb_generic_event_t*)&mne);
+    }
+    printf("motion: %d calls (expected 500)\n", calls);
+  }
+
+  // composite keys
+  dmux.on_property_notify(12, XCB_ATOM_WM_NAME, [](xcb_property_notify_event_t *ev) {
+    printf("WM_NAME of %d\n", ev->window);
+  });
+  dmux.on_property_notify(12, [](xcb_property_notify_event_t *ev) {
+    printf("property %d of %d\n", ev->atom, ev->window);
+  });
+  Connection kc = dmux.on_key_press(34, 38, [](xcb_key_press_event_t *ev) {
+    printf("keycode 38\n");
+  });
+
+  xcb_property_notify_event_t pne[] = {
+    { .response_type = XCB_PROPERTY_NOTIFY, .window = 12, .atom = XCB_ATOM_WM_NAME },
+    { .response_type = XCB_PROPERTY_NOTIFY, .window = 12, .atom = XCB_ATOM_WM_CLASS },
+    { .response_type = XCB_PROPERTY_NOTIFY, .window = 13, .atom = XCB_ATOM_WM_NAME }
+  };
+  for (auto &ev : pne) {
+    dmux.emit((xcb_generic_event_t*)&ev);
+  }
+  kpe.detail = 38;
+  dmux.emit((xcb_generic_event_t*)&kpe);
+  kpe.detail = 39;
+  dmux.emit((xcb_generic_event_t*)&kpe);
+  kc.disconnect();
+
+  // window objects
+  struct Widget : XcbWindowEvents<Widget> {
+    void on_expose(xcb_expose_event_t *ev) {
+      printf("widget expose %d\n", ev->window);
+    }
+    void on_key_press(xcb_key_press_event_t *ev) {
+      printf("widget key %d\n", ev->detail);
+    }
+  } widget;
+
+  dmux.attach(7, widget);
+  exp[0].count = 0;
+  dmux.emit((xcb_generic_event_t*)&exp[0]);
+  kpe.event = 7;
+  dmux.emit((xcb_generic_event_t*)&kpe);
+  dmux.emit((xcb_generic_event_t*)&pne[0]);  // (not handled by Widget)
+  dmux.detach(7);
+  dmux.emit((xcb_generic_event_t*)&exp[0]);
+
+  // the window index is only built once needed, then includes the handlers connected before;
+  // keys that are not windows (here: an atom with the same value) are not purged
+  {
+    struct TestDemux : XcbDemux {
+      size_t indexed() const { return window_idx.size(); }
+
+      Connection on_property_atom(xcb_atom_t atom, void (*fn)(xcb_property_notify_event_t *)) {
+        return _connect_mem<XCB_PROPERTY_NOTIFY, xcb_atom_t, &xcb_property_notify_event_t::atom>(atom, fn, {});
+      }
+    } tdmux;
+    Connection c1 = tdmux.on_map_notify(0x500000, [](xcb_map_notify_event_t *ev) { });
+    Connection c2 = tdmux.on_property_notify(0x500001, XCB_ATOM_WM_NAME, [](xcb_property_notify_event_t *ev) { });
+    Connection c3 = tdmux.on_property_atom(0x500000, [](xcb_property_notify_event_t *ev) { });
+    const size_t before = tdmux.indexed();
+    tdmux.purge(0x500000);
+    printf("indexed: %zu before purge, %zu after (expected 0, 1); purged %d %d %d (expected 1 0 0)\n",
+           before, tdmux.indexed(), !c1.connected(), !c2.connected(), !c3.connected());
+  }
+
+  // window churn: everything for a window is removed after its DestroyNotify
+  {
+    dmux.set_purge_on_destroy(true);
+    int destroyed = 0;
+    for (xcb_window_t win = 0x600000; win < 0x600000 + 10000; win++) {
+      Connection c1 = dmux.on_map_notify(win, [](xcb_map_notify_event_t *ev) { });
+      dmux.on_property_notify(win, XCB_ATOM_WM_NAME, [](xcb_property_notify_event_t *ev) { });
+      dmux.on_destroy_notify(win, [&destroyed](xcb_destroy_notify_event_t *ev) { destroyed++; });
+      dmux.attach(win, widget);
+
+      xcb_destroy_notify_event_t dne = { .response_type = XCB_DESTROY_NOTIFY, .event = win, .window = win };
+      dmux.emit((xcb_generic_event_t*)&dne);
+      if (c1.connected() || dmux.has_handlers(win)) {
+        printf("window %x not purged\n", win);
+        break;
+      }
+    }
+    printf("destroyed: %d (expected 10000)\n", destroyed);
+  }
 #endif
 
   return 0;
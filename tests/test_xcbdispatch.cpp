@@ -0,0 +1,39 @@
+#include "../xcbdispatch.h"
+#include <stdio.h>
+
+// g++ -Wall -std=c++11 -o test_xcbdispatch test_xcbdispatch.cpp `pkg-config --cflags xcb`
+
+static void on_release(xcb_key_release_event_t *ev) { printf("release %d\n", ev->detail); }
+
+int main()
+{
+  int exposes = 0;
+  auto dispatch = make_xcb_dispatcher(
+    [&exposes](xcb_expose_event_t *ev) { exposes++; },
+    xcb_on<XCB_KEY_PRESS>([](xcb_key_press_event_t *ev) {
+      printf("press %d\n", ev->detail);
+      return ev->detail != 9; // Escape: stop
+    }),
+    xcb_on<XCB_KEY_RELEASE>(on_release),
+//    [](xcb_key_press_event_t *ev) { }, // error: ambiguous
+    [](xcb_generic_event_t *ev) { printf("other %d\n", ev->response_type); }
+  );
+
+  xcb_expose_event_t ev1 = { XCB_EXPOSE };
+  xcb_key_press_event_t ev2 = { XCB_KEY_PRESS, 38 };
+  xcb_key_release_event_t ev3 = { XCB_KEY_RELEASE | 0x80, 38 }; // (send_event)
+  xcb_motion_notify_event_t ev4 = { XCB_MOTION_NOTIFY };
+  xcb_key_press_event_t ev5 = { XCB_KEY_PRESS, 9 };
+
+  xcb_generic_event_t *evs[] = { (xcb_generic_event_t *)&ev1, (xcb_generic_event_t *)&ev2, (xcb_generic_event_t *)&ev3,
+                                 (xcb_generic_event_t *)&ev4, (xcb_generic_event_t *)&ev1, (xcb_generic_event_t *)&ev5 };
+  for (auto ev : evs) {
+    if (!dispatch(ev)) {
+      printf("stop\n");
+      break;
+    }
+  }
+  printf("exposes %d\n", exposes);
+
+  return 0;
+}
@@ -36,6 +36,24 @@ ecs.emit((xcb_generic_event_t*)&ev1);
 xcb_motion_notify_event_t ev2 = { XCB_MOTION_NOTIFY };
 ecs.emit((xcb_generic_event_t*)&ev2);
 
+  ecs.on_batch<XCB_MOTION_NOTIFY>([](xcb_motion_notify_event_t *const *evs, size_t n) {
+printf("motion batch %zu\n", n);
+  });
+
+xcb_generic_event_t *evs[] = { (xcb_generic_event_t*)&ev2, (xcb_generic_event_t*)&ev2, (xcb_generic_event_t*)&ev1 };
+ecs.emit_batch(evs, 3);
+
+  // XGE, e.g. XInput2 (major opcode from xcb_get_extension_data(conn, &xcb_input_id)->major_opcode)
+  const uint8_t xi_opcode = 131;
+  ecs.on_generic(xi_opcode, 6 /* XCB_INPUT_MOTION */, [](xcb_ge_generic_event_t *ev) {
+printf("xi motion %d\n", ev->event_type);
+  });
+
+xcb_ge_generic_event_t ev3 = { XCB_GE_GENERIC, xi_opcode, 0, 0, 6 };
+ecs.emit((xcb_generic_event_t*)&ev3);
+ev3.event_type = 7;
+ecs.emit((xcb_generic_event_t*)&ev3); // nothing
+
   return 0;
 }
 
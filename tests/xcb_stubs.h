@@ -0,0 +1,46 @@
+#pragma once
+
+// replacements for the xcb functions used by XcbConnection, for tests that run without an X server.
+// Everything not replaced here (or in the test itself) still comes from libxcb. Include in exactly one translation unit.
+// q_read: events xcb has already read (xcb_poll_for_queued_event); q_socket: still on the socket,
+// moved to q_read by the next reading xcb_poll_for_event / xcb_wait_for_event.
+
+#include "../xcb_base.h"
+#include <stdlib.h>
+#include <deque>
+
+static std::deque<xcb_generic_event_t *> q_read, q_socket;
+static int socket_reads = 0, read_attempts = 0;
+static int writes = 0;  // xcb_flush calls
+static unsigned int sequence = 0;
+
+static inline unsigned int request() { // "sends" a request
+  return ++sequence;
+}
+
+static inline xcb_generic_event_t *pop(std::deque<xcb_generic_event_t *> &q) {
+  auto *ev = q.front();
+  q.pop_front();
+  return ev;
+}
+
+extern "C" {
+const xcb_setup_t *xcb_get_setup(xcb_connection_t *) { static xcb_setup_t s; return &s; }
+xcb_screen_iterator_t xcb_setup_roots_iterator(const xcb_setup_t *) { return {}; }
+uint32_t xcb_generate_id(xcb_connection_t *) { static uint32_t id = 0x100; return id++; }
+int xcb_flush(xcb_connection_t *) { writes++; return 1; }
+
+xcb_generic_event_t *xcb_poll_for_queued_event(xcb_connection_t *) { return q_read.empty() ? NULL : pop(q_read); }
+xcb_generic_event_t *xcb_poll_for_event(xcb_connection_t *c) {
+  if (q_read.empty()) read_attempts++;
+  if (q_read.empty() && !q_socket.empty()) { socket_reads++; q_read.swap(q_socket); }
+  return xcb_poll_for_queued_event(c);
+}
+xcb_generic_event_t *xcb_wait_for_event(xcb_connection_t *c) { return xcb_poll_for_event(c); }
+}
+
+// (nothing is sent anywhere)
+static inline XcbConnection &stub_connection() {
+  static XcbConnection conn((xcb_connection_t *)1, 0);
+  return conn;
+}
@@ -1,4 +1,7 @@
 #include "xcb_base.h"
+#include "flatmap.h"
+#include <algorithm>
+#include <stdio.h>
 #include <string.h>
 
 XcbError::XcbError(const std::string &str, int code)
@@ -124,6 +127,7 @@ std::pair<const xcb_visualtype_t *, uint8_t> XcbConnection::visualtype(xcb_scree
 
 void XcbConnection::flush()
 {
+  flush_due = false;
   const int res = xcb_flush(conn);
   if (res <= 0) {
     const int code = xcb_connection_has_error(conn);
@@ -133,6 +137,231 @@ void XcbConnection::flush()
   } // else: success
 }
 
+void XcbConnection::flush_soon()
+{
+  if (flush_policy == FLUSH_IMMEDIATE) {
+    flush();
+    return;
+  } else if (!flush_due) {
+    flush_due = true;
+    if (flush_policy == FLUSH_LATENCY) {
+      flush_due_since = std::chrono::steady_clock::now();
+    }
+  } else {
+    flush_overdue();
+  }
+}
+
+unique_xcb_generic_event_t XcbConnection::take_event(bool wait, bool queued_only)
+{
+  if (!pending.empty()) {
+    unique_xcb_generic_event_t ev = std::move(pending.front());
+    pending.pop_front();
+    return ev;
+  }
+  return read_event(wait, queued_only);
+}
+
+unique_xcb_generic_event_t XcbConnection::next_compressed_event(bool wait, bool queued_only)
+{
+  unique_xcb_generic_event_t ev = take_event(wait, queued_only);
+  while (ev) {
+    const uint8_t type = ev->response_type & ~0x80;
+    if (type == XCB_MOTION_NOTIFY && (compress_flags & COMPRESS_MOTION)) {
+      merge_motion(ev);
+    } else if (type == XCB_CONFIGURE_NOTIFY && (compress_flags & COMPRESS_CONFIGURE) &&
+               configure_superseded((xcb_configure_notify_event_t *)ev.get())) {
+      compression.configure_merged++;
+      ev = take_event(false); // (the superseding event is in pending)
+      continue;
+    }
+    break;
+  }
+  return ev;
+}
+
+// first event: as next_event(wait), i.e. at most one socket read; then only what xcb has already received
+size_t XcbConnection::fill_batch(bool wait, bool queued_only)
+{
+  // assert(batch.empty());
+  for (unique_xcb_generic_event_t ev = next_event(wait, queued_only); ev; ev = next_event(false, true)) {
+    if (ev->response_type == 0) {
+      if (batch.empty()) {
+        handle_error((xcb_generic_error_t *)ev.get());
+        continue;
+      }
+      pending.push_front(std::move(ev)); // (handled by the next batch)
+      break;
+    }
+    batch.push_back(ev.get());
+    ev.release();
+    if (batch.size() >= batch_limit) {
+      break;
+    }
+  }
+  return batch.size();
+}
+
+void XcbConnection::clear_batch()
+{
+  for (xcb_generic_event_t *ev : batch) {
+    ::free(ev);
+  }
+  batch.clear();
+}
+
+void XcbConnection::on_error(xcb_void_cookie_t cookie, XcbErrorFn fn)
+{
+  error_routes.push_back({next_route_id++, cookie.sequence, cookie.sequence + 1, false, std::move(fn)});
+}
+
+void XcbConnection::log_error(const xcb_generic_error_t *error)
+{
+  fprintf(stderr, "X error: %s (%d), request %d.%d, sequence %u, resource 0x%x\n",
+          XcbGenericError::get_error_string(error->error_code), error->error_code,
+          error->major_code, error->minor_code, error->full_sequence, error->resource_id);
+}
+
+uint64_t XcbConnection::open_error_scope(XcbErrorFn fn)
+{
+  const uint32_t begin = xcb_no_operation(conn).sequence + 1;
+  error_routes.push_back({next_route_id, begin, begin, true, std::move(fn)});
+  return next_route_id++;
+}
+
+void XcbConnection::close_error_scope(uint64_t id)
+{
+  const uint32_t end = xcb_no_operation(conn).sequence;
+  for (ErrorRoute &route : error_routes) {
+    if (route.id == id) {
+      route.end = end;
+      route.open = false;
+      return;
+    }
+  }
+}
+
+void XcbConnection::handle_error(const xcb_generic_error_t *error)
+{
+  const uint32_t seq = error->full_sequence;
+  for (auto it = error_routes.rbegin(); it != error_routes.rend(); ++it) { // (innermost / latest first)
+    if (uint32_t(seq - it->begin) < uint32_t(it->end - it->begin) ||
+        (it->open && int32_t(seq - it->begin) >= 0)) {
+      XcbErrorFn fn = it->fn; // (fn may register / close routes)
+      fn(error);
+      prune_error_routes(seq);
+      return;
+    }
+  }
+  prune_error_routes(seq);
+  if (!error_handler) {
+    throw XcbGenericError(error->error_code);
+  }
+  error_handler(error);
+}
+
+void XcbConnection::check_request(xcb_void_cookie_t cookie, const char *what)
+{
+  if (request_batch) {
+    request_batch->requests.push_back({cookie, what});
+    return;
+  }
+
+  unique_xcb_generic_error_t error{xcb_request_check(conn, cookie)};
+  synced(cookie.sequence);
+  if (error) {
+    throw XcbGenericError(what, error->error_code);
+  }
+}
+
+void XcbConnection::prune_error_routes(uint32_t sequence)
+{
+  // (sequence numbers wrap around)
+  auto it = std::remove_if(error_routes.begin(), error_routes.end(), [sequence](const ErrorRoute &route) {
+    return !route.open && int32_t(sequence - route.end) >= 0;
+  });
+  error_routes.erase(it, error_routes.end());
+}
+
+void XcbConnection::synced(uint32_t sequence)
+{
+  if (error_routes.empty()) {
+    return;
+  }
+  // routes with an error still queued are kept until it was handled (i.e. only up to the first queued error)
+  while (peek_queued(pending.size())) { }
+  for (const unique_xcb_generic_event_t &ev : pending) {
+    if (ev->response_type == 0 && int32_t(ev->full_sequence - sequence) < 0) {
+      sequence = ev->full_sequence;
+    }
+  }
+  prune_error_routes(sequence);
+}
+
+// does not read from the socket: only events xcb has already received (xcb_poll_for_queued_event)
+xcb_generic_event_t *XcbConnection::peek_queued(size_t idx)
+{
+  while (pending.size() <= idx) {
+    xcb_generic_event_t *ev = xcb_poll_for_queued_event(conn);
+    if (!ev) {
+      return NULL;
+    }
+    pending.emplace_back(ev);
+    configure_unscanned++;
+  }
+  return pending[idx].get();
+}
+
+void XcbConnection::merge_motion(unique_xcb_generic_event_t &ev)
+{
+  while (xcb_generic_event_t *next = peek_queued(0)) {
+    auto *cur = (xcb_motion_notify_event_t *)ev.get();
+    auto *nxt = (xcb_motion_notify_event_t *)next;
+    if ((next->response_type & ~0x80) != XCB_MOTION_NOTIFY ||
+        nxt->event != cur->event || nxt->state != cur->state) {
+      break;
+    }
+    ev = std::move(pending.front());
+    pending.pop_front();
+    compression.motion_merged++;
+  }
+}
+
+// one pass over everything xcb has already received (only when something new arrived since the last pass):
+// of the ConfigureNotify events in pending for the same (event, window), only the last one is kept.
+// Afterwards a ConfigureNotify taken from pending is not superseded, unless more events are received.
+bool XcbConnection::configure_superseded(const xcb_configure_notify_event_t *ev)
+{
+  while (peek_queued(pending.size())) { }
+  if (std::min(configure_unscanned, pending.size()) == 0) {
+    return false;
+  }
+  configure_unscanned = 0;
+
+  auto key = [](const xcb_generic_event_t *ev) {
+    auto *cn = (const xcb_configure_notify_event_t *)ev;
+    return (uint64_t(cn->event) << 32) | cn->window;
+  };
+  detail::flat_map<uint64_t, size_t> last;  // -> index in pending
+  for (size_t i = 0; i < pending.size(); i++) {
+    if ((pending[i]->response_type & ~0x80) == XCB_CONFIGURE_NOTIFY) {
+      *last.emplace(key(pending[i].get())).first = i;
+    }
+  }
+  size_t merged = 0;
+  for (size_t i = 0; i < pending.size(); i++) {
+    if ((pending[i]->response_type & ~0x80) == XCB_CONFIGURE_NOTIFY && *last.find(key(pending[i].get())) != i) {
+      pending[i].reset();
+      merged++;
+    }
+  }
+  if (merged) {
+    pending.erase(std::remove(pending.begin(), pending.end(), nullptr), pending.end());
+    compression.configure_merged += merged;
+  }
+  return last.find(key((const xcb_generic_event_t *)ev)) != nullptr;
+}
+
 XcbFuture<xcb_intern_atom_request_t, detail::intern_atom_atom> XcbConnection::intern_atom(const char *name, bool create)
 {
   // assert(name);
@@ -182,11 +411,55 @@ void XcbConnection::ungrab_pointer(xcb_timestamp_t time)
   }
 #else
   xcb_ungrab_pointer(conn, time);
-  flush();
+  flush_soon();
 #endif
 }
 
 
+XcbRequestBatch::~XcbRequestBatch()
+{
+  conn.request_batch = outer;
+  check(false);  // dtor shall be nothrow
+}
+
+void XcbRequestBatch::check(bool raise)
+{
+  if (requests.empty()) {
+    return;
+  }
+
+  // one round trip: afterwards xcb knows all requests up to here as completed, i.e. xcb_request_check does not sync again
+  const xcb_get_input_focus_cookie_t sync = xcb_get_input_focus(conn);
+  free(xcb_get_input_focus_reply(conn, sync, NULL));
+  conn.synced(sync.sequence);
+
+  std::vector<Request> checked;
+  checked.swap(requests);  // (fn may send further requests)
+
+  int first_code = -1;
+  const char *first_what = NULL;
+  for (const Request &req : checked) {
+    // each checked request must be checked, otherwise xcb keeps its error
+    unique_xcb_generic_error_t error{xcb_request_check(conn, req.cookie)};
+    if (!error) {
+      continue;
+    } else if (fn) {
+      fn(req.what, error.get());
+    } else if (raise && first_code < 0) {
+      first_code = error->error_code;
+      first_what = req.what;
+    } else {
+      fprintf(stderr, "%s failed: ", req.what);
+      XcbConnection::log_error(error.get());
+    }
+  }
+
+  if (first_code >= 0) {
+    throw XcbGenericError(first_what, first_code);
+  }
+}
+
+
 XcbColor::~XcbColor()
 {
   xcb_free_colors(conn, cmap, ~0, 1, &pixel);  // (unchecked)
@@ -210,11 +483,7 @@ XcbWindow::XcbWindow(
     x, y, width, height, border_width,
     XCB_WINDOW_CLASS_INPUT_OUTPUT, visual,
     value_mask, value_list.begin());
-
-  unique_xcb_generic_error_t error{xcb_request_check(conn, ck)};
-  if (error) {
-    throw XcbGenericError(error->error_code);
-  }
+  conn.check_request(ck, "XcbWindow::XcbWindow");
 #else
   xcb_create_window_checked(
     conn,
@@ -242,7 +511,7 @@ XcbWindow::~XcbWindow()
   }
 #else
   xcb_destroy_window(conn, win);
-  conn.flush();
+  conn.flush_soon();
 #endif
 }
 
@@ -267,11 +536,7 @@ std::pair<xcb_atom_t, xcb_atom_t> XcbWindow::install_delete_handler()
   };
 #if 1
   xcb_void_cookie_t ck = xcb_change_property_checked(conn, XCB_PROP_MODE_REPLACE, win, wmprotocols_atom, XCB_ATOM_ATOM, 8 * sizeof(*props), sizeof(props)/sizeof(*props), props);
-
-  unique_xcb_generic_error_t error{xcb_request_check(conn, ck)};
-  if (error) {
-    throw XcbGenericError("xcb_change_property_checked error", error->error_code);
-  }
+  conn.check_request(ck, "XcbWindow::install_delete_handler");
 #else
   xcb_change_property(conn, XCB_PROP_MODE_REPLACE, win, wmprotocols_atom, XCB_ATOM_ATOM, 8 * sizeof(*props), sizeof(props)/sizeof(*props), props);
 //  conn.flush();  // ?
@@ -284,11 +549,7 @@ void XcbWindow::map()
 {
 #if 1
   xcb_void_cookie_t ck = xcb_map_window_checked(conn, win);
-
-  unique_xcb_generic_error_t error{xcb_request_check(conn, ck)};
-  if (error) {
-    throw XcbGenericError(error->error_code);
-  }
+  conn.check_request(ck, "XcbWindow::map");
 #else
   xcb_map_window(conn, win);
   conn.flush();  // ?
@@ -299,11 +560,7 @@ void XcbWindow::unmap()
 {
 #if 1
   xcb_void_cookie_t ck = xcb_unmap_window_checked(conn, win);
-
-  unique_xcb_generic_error_t error{xcb_request_check(conn, ck)};
-  if (error) {
-    throw XcbGenericError(error->error_code);
-  }
+  conn.check_request(ck, "XcbWindow::unmap");
 #else
   xcb_unmap_window(conn, win);
   conn.flush();
@@ -314,11 +571,7 @@ void XcbWindow::change(uint32_t value_mask, std::initializer_list<const uint32_t
 {
 #if 1
   xcb_void_cookie_t ck = xcb_change_window_attributes_checked(conn, win, value_mask, value_list.begin());
-
-  unique_xcb_generic_error_t error{xcb_request_check(conn, ck)};
-  if (error) {
-    throw XcbGenericError(error->error_code);
-  }
+  conn.check_request(ck, "XcbWindow::change");
 #else
   xcb_change_window_attributes(conn, win, value_mask, value_list.begin());
   conn.flush();
@@ -336,11 +589,7 @@ XcbGC::XcbGC(
     conn, gc,
     drawable,
     value_mask, value_list.begin());
-
-  unique_xcb_generic_error_t error{xcb_request_check(conn, ck)};
-  if (error) {
-    throw XcbGenericError(error->error_code);
-  }
+  conn.check_request(ck, "XcbGC::XcbGC");
 }
 
 XcbGC::~XcbGC()
@@ -357,7 +606,7 @@ XcbGC::~XcbGC()
   }
 #else
   xcb_free_gc(conn, gc);
-  conn.flush();
+  conn.flush_soon();
 #endif
 }
 
@@ -365,11 +614,7 @@ void XcbGC::change(uint32_t value_mask, std::initializer_list<const uint32_t> va
 {
 #if 1
   xcb_void_cookie_t ck = xcb_change_gc_checked(conn, gc, value_mask, value_list.begin());
-
-  unique_xcb_generic_error_t error{xcb_request_check(conn, ck)};
-  if (error) {
-    throw XcbGenericError(error->error_code);
-  }
+  conn.check_request(ck, "XcbGC::change");
 #else
   xcb_change_gc(conn, gc, value_mask, value_list.begin());
 #endif
@@ -2,6 +2,9 @@
 
 #include <xcb/xcb.h>
 #include <stdexcept>
+#include <chrono>
+#include <deque>
+#include <functional>
 #include <vector>
 
 struct XcbError : std::runtime_error {
@@ -38,7 +41,15 @@ struct intern_atom_atom {
 using unique_xcb_generic_event_t = std::unique_ptr<xcb_generic_event_t, detail::c_free_deleter>;
 using unique_xcb_generic_error_t = std::unique_ptr<xcb_generic_error_t, detail::c_free_deleter>;
 
+// handler for X errors that arrive as events (i.e. of unchecked requests)
+using XcbErrorFn = std::function<void(const xcb_generic_error_t *error)>;
+
+// handler for errors of the void requests collected by an XcbRequestBatch; what: the originating call (e.g. "XcbWindow::map")
+using XcbRequestErrorFn = std::function<void(const char *what, const xcb_generic_error_t *error)>;
+
 class XcbColor;
+class XcbErrorScope;
+class XcbRequestBatch;
 
 struct XcbConnection final {
   XcbConnection(const char *name = NULL);
@@ -52,6 +63,41 @@ struct XcbConnection final {
   void flush();
   // ? void sync(); -> xcb_aux_sync(conn); ?
 
+  // when the unchecked requests of the wrappers (e.g. ~XcbWindow, ~XcbGC, ungrab_pointer) are written, cf. flush_soon():
+  // FLUSH_IMMEDIATE: right away, i.e. one write each (default),
+  // FLUSH_DEFERRED: once, when the event loop has handled all pending events / before it blocks (or by flush_pending()),
+  // FLUSH_LATENCY: as FLUSH_DEFERRED, but also once budget has passed since the oldest unwritten one - checked by flush_soon()
+  // and by the event loop after each handled event / batch (blocking always writes everything first, i.e. no timer is needed).
+  enum FlushPolicy {
+    FLUSH_IMMEDIATE,
+    FLUSH_DEFERRED,
+    FLUSH_LATENCY
+  };
+
+  void set_flush_policy(FlushPolicy policy, std::chrono::microseconds budget = std::chrono::milliseconds(5)) {
+    flush_policy = policy;
+    flush_budget = budget;
+    if (policy == FLUSH_IMMEDIATE) {
+      flush_pending();
+    }
+  }
+
+  void flush_soon();
+
+  void flush_pending() {
+    if (flush_due) {
+      flush();
+    }
+  }
+
+  // FLUSH_LATENCY: flushes when the budget has passed
+  void flush_overdue() {
+    if (flush_due && flush_policy == FLUSH_LATENCY &&
+        std::chrono::steady_clock::now() - flush_due_since >= flush_budget) {
+      flush();
+    }
+  }
+
   int fd() { // for polling
     return xcb_get_file_descriptor(conn);
   }
@@ -66,28 +112,77 @@ struct XcbConnection final {
     return {conn, !create, len, name};
   }
 
+  // opt-in compression of the event stream (in run_once / wait_once), looking ahead only at events xcb has already read:
+  // COMPRESS_MOTION: consecutive MotionNotify for the same window and button state are collapsed into the last one,
+  // COMPRESS_CONFIGURE: a ConfigureNotify is dropped, when a later one for the same window is already queued.
+  enum CompressFlags {
+    COMPRESS_NONE      = 0,
+    COMPRESS_MOTION    = 0x01,
+    COMPRESS_CONFIGURE = 0x02
+  };
+
+  struct CompressionStats {
+    uint64_t motion_merged = 0;
+    uint64_t configure_merged = 0;
+  };
+
+  void set_compression(unsigned int flags) {
+    compress_flags = flags;
+  }
+
+  const CompressionStats &compression_stats() const {
+    return compression;
+  }
+
+  void reset_compression_stats() {
+    compression = {};
+  }
+
+  // X errors of unchecked requests arrive as events; the event loop routes them by sequence number:
+  // to on_error(cookie, fn) for a single request, to the innermost XcbErrorScope they were sent in,
+  // or else to the default handler - log_error (stderr) and continue, cf. set_error_handler.
+  void on_error(xcb_void_cookie_t cookie, XcbErrorFn fn);
+
+  // routes are dropped once no error can arrive for them any more: when a later event / error was handled,
+  // or after a round trip (check_request, XcbRequestBatch)
+  size_t error_route_count() const {
+    return error_routes.size();
+  }
+
+  // nullptr: throw XcbGenericError from run_once / wait_once / run_batch_once (i.e. end the event loop)
+  void set_error_handler(XcbErrorFn fn) {
+    error_handler = std::move(fn);
+  }
+
+  static void log_error(const xcb_generic_error_t *error);
+
+  // void requests of the wrappers (XcbWindow, XcbGC, ...) are checked right away, i.e. one round trip each
+  // (throws XcbGenericError(what, code)) - or, while an XcbRequestBatch is alive, collected by it.
+  void check_request(xcb_void_cookie_t cookie, const char *what);
+
   template <typename Fn>
   bool run_once(Fn&& fn) {
-    while (auto ev = unique_xcb_generic_event_t{xcb_poll_for_event(conn)}) {
+    while (auto ev = next_event(false)) {
       if (ev->response_type == 0) {
-        auto code = ((xcb_generic_error_t *)ev.get())->error_code;
-        throw XcbGenericError(code);
-      } else if (!fn(ev.get())) {
+        handle_error((xcb_generic_error_t *)ev.get());
+      } else if (seen(ev.get()), !fn(ev.get())) {
         return false;
       }
+      flush_overdue(); // (long drains)
     }
+    flush_pending();
     return true;
   }
 
   template <typename Fn>
   bool wait_once(Fn&& fn) {
-    auto ev = unique_xcb_generic_event_t{xcb_wait_for_event(conn)};
+    flush_pending(); // (before blocking)
+    auto ev = next_event(true);
     if (!ev) {
       return true;
     } else if (ev->response_type == 0) {
-      auto code = ((xcb_generic_error_t *)ev.get())->error_code;
-      throw XcbGenericError(code);
-    } else if (!fn(ev.get())) {
+      handle_error((xcb_generic_error_t *)ev.get());
+    } else if (seen(ev.get()), !fn(ev.get())) {
       return false;
     }
     return true;
@@ -98,6 +193,70 @@ struct XcbConnection final {
     while (wait_once((Fn&&)fn));
   }
 
+  // idle() is called each time all pending events have been handled (e.g. EmitQueue::dispatch)
+  template <typename Fn, typename IdleFn>
+  bool run_once(Fn&& fn, IdleFn&& idle) {
+    if (!run_once(fn)) {
+      return false;
+    }
+    idle();
+    return true;
+  }
+
+  template <typename Fn, typename IdleFn>
+  void run(Fn&& fn, IdleFn&& idle) {
+    while (run_once(fn, idle) && wait_once(fn));
+  }
+
+  // batched drain: one socket read, then everything xcb has already queued (xcb_poll_for_queued_event)
+  // - at most batch_limit events - goes to fn(xcb_generic_event_t *const *evs, size_t n) at once
+  // (e.g. XcbEventCallbacks::emit_batch); fn returns false to stop. Compression is applied while the batch is filled.
+  // The events (and pointers) are only valid during fn; the buffer is reused, i.e. fn must not start another drain.
+  // An error ends the batch; it is handled (cf. on_error) once the events before it were.
+  //   conn.run_batched([&ecs](xcb_generic_event_t *const *evs, size_t n) { ecs.emit_batch(evs, n); return true; });
+  template <typename Fn>
+  bool run_batch_once(Fn&& fn) {
+    for (bool queued_only = false; ; queued_only = true) { // (further batches: no more socket reads)
+      const int res = dispatch_batch(fn, false, queued_only);
+      if (res < 0) {
+        return false;
+      } else if (res == 0) {
+        flush_pending();
+        return true;
+      }
+      flush_overdue();
+    }
+  }
+
+  template <typename Fn>
+  bool wait_batch_once(Fn&& fn) {
+    flush_pending(); // (before blocking)
+    return (dispatch_batch(fn, true, false) >= 0);
+  }
+
+  template <typename Fn>
+  void run_batched(Fn&& fn) {
+    while (wait_batch_once(fn));
+  }
+
+  template <typename Fn, typename IdleFn>
+  bool run_batch_once(Fn&& fn, IdleFn&& idle) {
+    if (!run_batch_once(fn)) {
+      return false;
+    }
+    idle();
+    return true;
+  }
+
+  template <typename Fn, typename IdleFn>
+  void run_batched(Fn&& fn, IdleFn&& idle) {
+    while (run_batch_once(fn, idle) && wait_batch_once(fn));
+  }
+
+  void set_batch_limit(size_t limit) {
+    batch_limit = (limit) ? limit : 1;
+  }
+
 //  const xcb_setup_t *get_setup() const { return setup; }
 
   int screen_count() {
@@ -222,8 +381,73 @@ struct XcbConnection final {
   XcbColor color(uint16_t red, uint16_t green, uint16_t blue); // (cmap = default_colormap());
 
 private:
+  friend class XcbErrorScope;
+  friend class XcbRequestBatch;
+
   void cache_screens();
 
+  // errors for sequence numbers in [begin, end) go to fn; open: end not yet known (scope still alive)
+  struct ErrorRoute {
+    uint64_t id;
+    uint32_t begin, end;
+    bool open;
+    XcbErrorFn fn;
+  };
+
+  uint64_t open_error_scope(XcbErrorFn fn);
+  void close_error_scope(uint64_t id);
+  void handle_error(const xcb_generic_error_t *error);
+  void prune_error_routes(uint32_t sequence);
+
+  // routes that end before ev can be dropped: the server answers in order, i.e. their errors would have arrived before ev
+  void seen(const xcb_generic_event_t *ev) {
+    if (!error_routes.empty()) {
+      prune_error_routes(ev->full_sequence);
+    }
+  }
+
+  // after a round trip: everything before sequence has been received - but errors may still wait in the queue
+  void synced(uint32_t sequence);
+
+  // queued_only: does not read from the socket
+  unique_xcb_generic_event_t read_event(bool wait, bool queued_only = false) {
+    return unique_xcb_generic_event_t{(queued_only) ? xcb_poll_for_queued_event(conn) :
+                                      (wait) ? xcb_wait_for_event(conn) : xcb_poll_for_event(conn)};
+  }
+
+  unique_xcb_generic_event_t next_event(bool wait, bool queued_only = false) {
+    if (!compress_flags && pending.empty()) {
+      return read_event(wait, queued_only);
+    }
+    return next_compressed_event(wait, queued_only);
+  }
+
+  // -1: fn returned false, otherwise number of events
+  template <typename Fn>
+  int dispatch_batch(Fn& fn, bool wait, bool queued_only) {
+    struct guard {
+      ~guard() { self.clear_batch(); }
+      XcbConnection &self;
+    } g{*this};
+    const size_t n = fill_batch(wait, queued_only);
+    if (n) {
+      seen(batch.back());
+    }
+    if (n && !fn(static_cast<xcb_generic_event_t *const *>(batch.data()), n)) {
+      return -1;
+    }
+    return n;
+  }
+
+  size_t fill_batch(bool wait, bool queued_only);
+  void clear_batch();
+
+  unique_xcb_generic_event_t take_event(bool wait, bool queued_only = false);
+  unique_xcb_generic_event_t next_compressed_event(bool wait, bool queued_only);
+  xcb_generic_event_t *peek_queued(size_t idx);
+  void merge_motion(unique_xcb_generic_event_t &ev);
+  bool configure_superseded(const xcb_configure_notify_event_t *ev);
+
 private:
   xcb_connection_t *conn;
   bool owned;
@@ -231,6 +455,101 @@ private:
 
   const xcb_setup_t *setup;
   std::vector<xcb_screen_t *> screen_cache;
+
+  unsigned int compress_flags = COMPRESS_NONE;
+  CompressionStats compression;
+  std::deque<unique_xcb_generic_event_t> pending;  // already read by look-ahead
+  size_t configure_unscanned = 0;  // events at the back of pending not yet seen by configure_superseded
+
+  std::vector<xcb_generic_event_t *> batch;  // (owned while filled)
+  size_t batch_limit = 256;
+
+  std::vector<ErrorRoute> error_routes;  // (in order of registration)
+  uint64_t next_route_id = 0;
+  XcbErrorFn error_handler = log_error;
+
+  XcbRequestBatch *request_batch = nullptr;  // (innermost)
+
+  FlushPolicy flush_policy = FLUSH_IMMEDIATE;
+  std::chrono::microseconds flush_budget{0};
+  bool flush_due = false;
+  std::chrono::steady_clock::time_point flush_due_since;  // (oldest unwritten flush_soon)
+};
+
+// errors of all requests sent while the scope is alive go to fn (instead of the default handler),
+// also when they only arrive later (asynchronously, via the event loop).
+// NOTE: The scope is delimited by two NoOperation requests (xcb has no other way to get the current sequence number).
+//   {
+//     XcbErrorScope scope(conn, [](const xcb_generic_error_t *error) { ... });
+//     xcb_map_window(conn, win);  // unchecked
+//   }
+class XcbErrorScope final {
+public:
+  XcbErrorScope(XcbConnection &conn, XcbErrorFn fn)
+    : conn(conn), id(conn.open_error_scope(std::move(fn)))
+  { }
+
+  ~XcbErrorScope() {
+    conn.close_error_scope(id);
+  }
+
+  XcbErrorScope(const XcbErrorScope &) = delete;
+  XcbErrorScope &operator=(const XcbErrorScope &) = delete;
+
+private:
+  XcbConnection &conn;
+  uint64_t id;
+};
+
+// collects the void requests of the wrappers (instead of one round trip per call) and checks them all with a single sync
+// at check() or at the end of the scope. Errors are attributed to the originating call: without fn, check() throws
+// XcbGenericError(what, code) for the first failed request (further ones are logged); with fn, each goes to fn.
+// The destructor does not throw: errors not yet checked go to fn, or are logged.
+// NOTE: A wrapper constructed inside the batch exists even when its resource could not be created (error only at check()).
+//   {
+//     XcbRequestBatch batch(conn);
+//     for (...) {
+//       children.emplace_back(new XcbWindow(conn, parent, 20, 20));
+//       children.back()->map();
+//     }
+//     batch.check();
+//   }
+class XcbRequestBatch final {
+public:
+  XcbRequestBatch(XcbConnection &conn, XcbRequestErrorFn fn = nullptr)
+    : conn(conn), outer(conn.request_batch), fn(std::move(fn))
+  {
+    conn.request_batch = this;
+  }
+
+  ~XcbRequestBatch();
+
+  XcbRequestBatch(const XcbRequestBatch &) = delete;
+  XcbRequestBatch &operator=(const XcbRequestBatch &) = delete;
+
+  void check() {
+    check(true);
+  }
+
+  size_t size() const {
+    return requests.size();
+  }
+
+private:
+  friend struct XcbConnection;
+
+  struct Request {
+    xcb_void_cookie_t cookie;
+    const char *what;
+  };
+
+  void check(bool raise);
+
+private:
+  XcbConnection &conn;
+  XcbRequestBatch *outer;
+  XcbRequestErrorFn fn;
+  std::vector<Request> requests;  // (in order of sending)
 };
 
 class XcbColor final { // "unique XcbColor" resource wrapper
@@ -0,0 +1,156 @@
+#pragma once
+
+// Extension events arrive at first_event + n (or, for XGE extensions, as XCB_GE_GENERIC with the major opcode),
+// which is only known at runtime.  XcbExtensions resolves the bases once per connection;
+// XcbEventCallbacks::on_ext<Ext, N>(exts, fn) then registers fn directly in the dispatch table,
+// i.e. extension events are routed with the same single lookup as core events.
+//   #include <xcb/randr.h>   // (before xcbevents.h / xcb_extensions.h: enables the XcbRandr mappings)
+//   XcbExtensions exts(conn);
+//   exts.prefetch<XcbRandr, XcbDamage>();  // (optional: one round trip for all)
+//   ecs.on_ext<XcbRandr, XCB_RANDR_SCREEN_CHANGE_NOTIFY>(exts, [](xcb_randr_screen_change_notify_event_t *ev) { ... });
+// NOTE: All XKB events share first_event (xkbType is in the second byte), cf. XkbXcbProcessor::process:
+//   ecs.on_ext<XcbXkb, 0>(exts, [&proc](xcb_generic_event_t *ev) { proc.process((xkb_event_t *)ev); });
+
+#include <xcb/xcb.h>
+#include <utility>
+#include <vector>
+
+// extension tags
+struct XcbRandr;
+struct XcbDamage;
+struct XcbShape;
+struct XcbXfixes;
+struct XcbXkb;
+struct XcbInput2;  // XGE
+struct XcbPresent; // XGE
+
+namespace detail {
+
+template <typename Ext>
+struct ext_traits;  // static xcb_extension_t *id(); static constexpr bool xge;
+
+// unmapped (Ext, N): cf. the static_assert in XcbEventCallbacks::on_ext
+template <typename Ext, uint16_t N>
+struct ext_event_handler_type {
+  static constexpr bool mapped = false;
+  using type = xcb_generic_event_t;
+};
+
+#define SET_EXT_ENTRY(Ext, Name, Xge)                      \
+  template <>                                              \
+  struct ext_traits<Ext> {                                 \
+    static xcb_extension_t *id() { return &xcb_ ## Name ## _id; } \
+    static constexpr bool xge = Xge;                       \
+  }
+
+#define SET_EXT_EVHT_ENTRY(Ext, Val, Name)                 \
+  template <>                                              \
+  struct ext_event_handler_type<Ext, XCB_ ## Val> {        \
+    static constexpr bool mapped = true;                   \
+    using type = xcb_ ## Name ## _event_t;                 \
+  }
+
+#ifdef __RANDR_H
+SET_EXT_ENTRY(XcbRandr, randr, false);
+SET_EXT_EVHT_ENTRY(XcbRandr, RANDR_SCREEN_CHANGE_NOTIFY, randr_screen_change_notify);
+SET_EXT_EVHT_ENTRY(XcbRandr, RANDR_NOTIFY, randr_notify);
+#endif
+
+#ifdef __DAMAGE_H
+SET_EXT_ENTRY(XcbDamage, damage, false);
+SET_EXT_EVHT_ENTRY(XcbDamage, DAMAGE_NOTIFY, damage_notify);
+#endif
+
+#ifdef __SHAPE_H
+SET_EXT_ENTRY(XcbShape, shape, false);
+SET_EXT_EVHT_ENTRY(XcbShape, SHAPE_NOTIFY, shape_notify);
+#endif
+
+#ifdef __XFIXES_H
+SET_EXT_ENTRY(XcbXfixes, xfixes, false);
+SET_EXT_EVHT_ENTRY(XcbXfixes, XFIXES_SELECTION_NOTIFY, xfixes_selection_notify);
+SET_EXT_EVHT_ENTRY(XcbXfixes, XFIXES_CURSOR_NOTIFY, xfixes_cursor_notify);
+#endif
+
+#ifdef __XKB_H
+SET_EXT_ENTRY(XcbXkb, xkb, false);
+template <>
+struct ext_event_handler_type<XcbXkb, 0> { // (only N = 0: all XKB events)
+  static constexpr bool mapped = true;
+  using type = xcb_generic_event_t;  // (dispatch on xkbType)
+};
+#endif
+
+#ifdef __XINPUT_H
+SET_EXT_ENTRY(XcbInput2, input, true);
+SET_EXT_EVHT_ENTRY(XcbInput2, INPUT_KEY_PRESS, input_key_press);
+SET_EXT_EVHT_ENTRY(XcbInput2, INPUT_KEY_RELEASE, input_key_release);
+SET_EXT_EVHT_ENTRY(XcbInput2, INPUT_BUTTON_PRESS, input_button_press);
+SET_EXT_EVHT_ENTRY(XcbInput2, INPUT_BUTTON_RELEASE, input_button_release);
+SET_EXT_EVHT_ENTRY(XcbInput2, INPUT_MOTION, input_motion);
+SET_EXT_EVHT_ENTRY(XcbInput2, INPUT_ENTER, input_enter);
+SET_EXT_EVHT_ENTRY(XcbInput2, INPUT_LEAVE, input_leave);
+SET_EXT_EVHT_ENTRY(XcbInput2, INPUT_FOCUS_IN, input_focus_in);
+SET_EXT_EVHT_ENTRY(XcbInput2, INPUT_FOCUS_OUT, input_focus_out);
+SET_EXT_EVHT_ENTRY(XcbInput2, INPUT_HIERARCHY, input_hierarchy);
+SET_EXT_EVHT_ENTRY(XcbInput2, INPUT_RAW_MOTION, input_raw_motion);
+SET_EXT_EVHT_ENTRY(XcbInput2, INPUT_TOUCH_BEGIN, input_touch_begin);
+SET_EXT_EVHT_ENTRY(XcbInput2, INPUT_TOUCH_UPDATE, input_touch_update);
+SET_EXT_EVHT_ENTRY(XcbInput2, INPUT_TOUCH_END, input_touch_end);
+#endif
+
+#ifdef __PRESENT_H
+SET_EXT_ENTRY(XcbPresent, present, true);
+SET_EXT_EVHT_ENTRY(XcbPresent, PRESENT_CONFIGURE_NOTIFY, present_configure_notify);
+SET_EXT_EVHT_ENTRY(XcbPresent, PRESENT_COMPLETE_NOTIFY, present_complete_notify);
+SET_EXT_EVHT_ENTRY(XcbPresent, PRESENT_IDLE_NOTIFY, present_idle_notify);
+#endif
+
+#undef SET_EXT_EVHT_ENTRY
+#undef SET_EXT_ENTRY
+
+} // namespace detail
+
+class XcbExtensions final {
+public:
+  explicit XcbExtensions(xcb_connection_t *conn)
+    : conn(conn)
+  { }
+
+  XcbExtensions(const XcbExtensions &) = delete;
+  XcbExtensions &operator=(const XcbExtensions &) = delete;
+
+  // sends the QueryExtension requests for all Exts at once (otherwise each first get() costs a round trip)
+  template <typename... Exts>
+  void prefetch() {
+    const int dummy[] = {0, (xcb_prefetch_extension_data(conn, detail::ext_traits<Exts>::id()), 0)...};
+    (void)dummy;
+  }
+
+  // nullptr: extension not present
+  template <typename Ext>
+  const xcb_query_extension_reply_t *get() {
+    xcb_extension_t *id = detail::ext_traits<Ext>::id();
+    for (const auto &entry : cache) {
+      if (entry.first == id) {
+        return entry.second;
+      }
+    }
+    const xcb_query_extension_reply_t *reply = xcb_get_extension_data(conn, id); // (owned by xcb)
+    if (reply && !reply->present) {
+      reply = nullptr;
+    }
+    cache.emplace_back(id, reply);
+    return reply;
+  }
+
+  template <typename Ext>
+  bool present() {
+    return get<Ext>();
+  }
+
+private:
+  xcb_connection_t *conn;
+  std::vector<std::pair<xcb_extension_t *, const xcb_query_extension_reply_t *>> cache;
+};
+
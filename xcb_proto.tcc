@@ -1,6 +1,8 @@
 #pragma once
 
 #include <xcb/xproto.h>
+#include <memory>
+#include <type_traits>
 
 namespace detail {
 
@@ -118,5 +120,95 @@ SET_EVHT_ENTRY(GE_GENERIC, ge_generic);
 
 #undef SET_EVHT_ENTRY
 
+// reverse mapping (event struct -> response type); -1: unknown or ambiguous
+// (xcb_key_release_event_t is xcb_key_press_event_t, likewise button_release, leave_notify, focus_out, circulate_request)
+template <typename EventType>
+struct event_type_code : std::integral_constant<int, -1> { };
+
+#define SET_EVTC_ENTRY(Val, Name) \
+  template <>                                                \
+  struct event_type_code<xcb_ ## Name ## _event_t>           \
+    : std::integral_constant<int, XCB_ ## Val> { }
+
+SET_EVTC_ENTRY(KEYMAP_NOTIFY, keymap_notify);
+SET_EVTC_ENTRY(EXPOSE, expose);
+SET_EVTC_ENTRY(GRAPHICS_EXPOSURE, graphics_exposure);
+SET_EVTC_ENTRY(NO_EXPOSURE, no_exposure);
+SET_EVTC_ENTRY(VISIBILITY_NOTIFY, visibility_notify);
+SET_EVTC_ENTRY(CREATE_NOTIFY, create_notify);
+SET_EVTC_ENTRY(DESTROY_NOTIFY, destroy_notify);
+SET_EVTC_ENTRY(UNMAP_NOTIFY, unmap_notify);
+SET_EVTC_ENTRY(MAP_NOTIFY, map_notify);
+SET_EVTC_ENTRY(MAP_REQUEST, map_request);
+SET_EVTC_ENTRY(REPARENT_NOTIFY, reparent_notify);
+SET_EVTC_ENTRY(CONFIGURE_NOTIFY, configure_notify);
+SET_EVTC_ENTRY(CONFIGURE_REQUEST, configure_request);
+SET_EVTC_ENTRY(GRAVITY_NOTIFY, gravity_notify);
+SET_EVTC_ENTRY(RESIZE_REQUEST, resize_request);
+SET_EVTC_ENTRY(PROPERTY_NOTIFY, property_notify);
+SET_EVTC_ENTRY(SELECTION_CLEAR, selection_clear);
+SET_EVTC_ENTRY(SELECTION_REQUEST, selection_request);
+SET_EVTC_ENTRY(SELECTION_NOTIFY, selection_notify);
+SET_EVTC_ENTRY(COLORMAP_NOTIFY, colormap_notify);
+SET_EVTC_ENTRY(CLIENT_MESSAGE, client_message);
+SET_EVTC_ENTRY(MAPPING_NOTIFY, mapping_notify);
+SET_EVTC_ENTRY(GE_GENERIC, ge_generic);
+SET_EVTC_ENTRY(MOTION_NOTIFY, motion_notify);
+
+#undef SET_EVTC_ENTRY
+
+// core events that concern a single window: X(name, VAL, member holding the window).
+// (structure events: the window concerned, not the one the event was selected on, i.e. not the parent)
+#define XCB_FOR_WINDOW_EVENTS(X) \
+  X(key_press, KEY_PRESS, event)                   \
+  X(key_release, KEY_RELEASE, event)               \
+  X(button_press, BUTTON_PRESS, event)             \
+  X(button_release, BUTTON_RELEASE, event)         \
+  X(motion_notify, MOTION_NOTIFY, event)           \
+  X(enter_notify, ENTER_NOTIFY, event)             \
+  X(leave_notify, LEAVE_NOTIFY, event)             \
+  X(focus_in, FOCUS_IN, event)                     \
+  X(focus_out, FOCUS_OUT, event)                   \
+  X(expose, EXPOSE, window)                        \
+  X(graphics_exposure, GRAPHICS_EXPOSURE, drawable) \
+  X(no_exposure, NO_EXPOSURE, drawable)            \
+  X(visibility_notify, VISIBILITY_NOTIFY, window)  \
+  X(create_notify, CREATE_NOTIFY, window)          \
+  X(destroy_notify, DESTROY_NOTIFY, window)        \
+  X(unmap_notify, UNMAP_NOTIFY, window)            \
+  X(map_notify, MAP_NOTIFY, window)                \
+  X(map_request, MAP_REQUEST, window)              \
+  X(reparent_notify, REPARENT_NOTIFY, window)      \
+  X(configure_notify, CONFIGURE_NOTIFY, window)    \
+  X(configure_request, CONFIGURE_REQUEST, window)  \
+  X(gravity_notify, GRAVITY_NOTIFY, window)        \
+  X(resize_request, RESIZE_REQUEST, window)        \
+  X(circulate_notify, CIRCULATE_NOTIFY, window)    \
+  X(circulate_request, CIRCULATE_REQUEST, window)  \
+  X(property_notify, PROPERTY_NOTIFY, window)      \
+  X(selection_clear, SELECTION_CLEAR, owner)       \
+  X(selection_request, SELECTION_REQUEST, owner)   \
+  X(selection_notify, SELECTION_NOTIFY, requestor) \
+  X(colormap_notify, COLORMAP_NOTIFY, window)      \
+  X(client_message, CLIENT_MESSAGE, window)
+
+// calls fn(const EventTypePtr *evs, n) with a typed copy of evs
+// (reading the xcb_generic_event_t * array as EventTypePtr array would break strict aliasing)
+template <typename EventTypePtr, typename Fn>
+void with_typed_events(xcb_generic_event_t *const *evs, size_t n, Fn&& fn)
+{
+  EventTypePtr buf[64];
+  std::unique_ptr<EventTypePtr[]> heap;
+  EventTypePtr *typed = buf;
+  if (n > sizeof(buf) / sizeof(*buf)) {
+    heap.reset(new EventTypePtr[n]);
+    typed = heap.get();
+  }
+  for (size_t i = 0; i < n; i++) {
+    typed[i] = (EventTypePtr)evs[i];
+  }
+  fn(static_cast<EventTypePtr const *>(typed), n);
+}
+
 } // namespace detail
 
@@ -1,14 +1,19 @@
 #pragma once
 
 #include "xcbevents.h"
+#include "flatmap.h"
+#include <algorithm>
+#include <tuple>
 #include <typeindex>
+#include <unordered_map>
+#include <vector>
 
 namespace detail {
 
 struct pairhash {
   template <typename T1, typename T2>
   std::size_t operator()(const std::pair<T1, T2> &p) const {
-    return std::hash<T1>{}(p.first) ^ std::hash<T2>{}(p.second);
+    return hash_combine(std::hash<T1>{}(p.first), std::hash<T2>{}(p.second));
   }
 };
 
@@ -47,51 +52,223 @@ private:
 };
 
 
-struct signal_for_mem_base {
-  virtual ~signal_for_mem_base() = default;
+struct signal_for_mem_base : arena_object {
+  virtual void add_to_index() { } // cf. window_index::enable
 };
 
-// OnConnectFn(Fn&&), OnEmptyFn()
-template <typename EventType, typename T, T EventType::*Mem, typename OnConnectFn, typename OnEmptyFn>
-class signal_for_mem final : public signal_for_mem_base {
+// key of an event: one member ...
+template <typename EventType, typename T, T EventType::*Mem>
+struct mem_key {
+  using type = T;
+  static constexpr bool has_window = false;
+
+  static T get(const EventType *ev) {
+    return ev->*Mem;
+  }
+
+  static xcb_window_t window(const T &) {
+    return XCB_NONE;
+  }
+};
+
+// ... that is a window (-> window_index); xcb_window_t alone does not tell, atoms etc. are uint32_t as well
+template <typename EventType, typename T, T EventType::*Mem>
+struct window_key : mem_key<EventType, T, Mem> {
+  static_assert(std::is_same<T, xcb_window_t>::value, "window_key: member must be a xcb_window_t");
+  static constexpr bool has_window = true;
+
+  static xcb_window_t window(xcb_window_t key) {
+    return key;
+  }
+};
+
+// ... or a std::tuple of members, e.g. (window, atom) - the window, if any, must come first
+template <typename... MemKeys>
+struct mem_keys {
+  using type = std::tuple<typename MemKeys::type...>;
+  using first = typename std::tuple_element<0, std::tuple<MemKeys...>>::type;
+  static constexpr bool has_window = first::has_window;
+
+  static xcb_window_t window(const type &key) {
+    return first::window(std::get<0>(key));
+  }
+
+  template <typename EventType>
+  static type get(const EventType *ev) {
+    return type{MemKeys::get(ev)...};
+  }
+};
+
+template <typename T>
+struct key_hash : std::hash<T> { };
+
+template <typename... Ts>
+struct key_hash<std::tuple<Ts...>> {
+  std::size_t operator()(const std::tuple<Ts...> &key) const {
+    return combine<0>(key, 0);
+  }
+
+private:
+  template <size_t I>
+  static typename std::enable_if<(I < sizeof...(Ts)), std::size_t>::type combine(const std::tuple<Ts...> &key, std::size_t seed) {
+    using T = typename std::tuple_element<I, std::tuple<Ts...>>::type;
+    return combine<I + 1>(key, hash_combine(seed, std::hash<T>{}(std::get<I>(key))));
+  }
+
+  template <size_t I>
+  static typename std::enable_if<(I == sizeof...(Ts)), std::size_t>::type combine(const std::tuple<Ts...> &, std::size_t seed) {
+    return seed;
+  }
+};
+
+struct window_keyed_base {
+  virtual void clear() = 0;
+};
+
+// all per-key signals of a window, e.g. to remove them when the window is destroyed.
+// Starts disabled (add() does nothing): the owner enables it once it is needed and then adds the existing signals.
+class window_index {
+public:
+  bool enabled() const {
+    return on;
+  }
+
+  void enable() {
+    on = true;
+  }
+
+  void add(xcb_window_t win, window_keyed_base *sig) {
+    if (on) {
+      windows[win].push_back(sig);
+    }
+  }
+
+  void remove(xcb_window_t win, window_keyed_base *sig) {
+    std::vector<window_keyed_base *> *list = windows.find(win);
+    if (!list) {
+      return;
+    }
+    auto it = std::find(list->begin(), list->end(), sig);
+    if (it != list->end()) {
+      list->erase(it);
+    }
+    if (list->empty()) {
+      windows.erase(win);
+    }
+  }
+
+  // disconnects all handlers of win: O(handlers of win)
+  void clear(xcb_window_t win) {
+    std::vector<window_keyed_base *> *list = windows.find(win);
+    if (!list) {
+      return;
+    }
+    const std::vector<window_keyed_base *> tmp = *list; // (clear() removes the signal; busy ones only later)
+    for (window_keyed_base *sig : tmp) {
+      sig->clear();
+    }
+  }
+
+  bool contains(xcb_window_t win) const {
+    return windows.find(win);
+  }
+
+  std::size_t size() const {
+    return windows.size();
+  }
+
+private:
+  flat_map<xcb_window_t, std::vector<window_keyed_base *>> windows;
+  bool on = false;
+};
+
+// only the signal for the exact key of an event is emitted.
+// KeyFn: cf. mem_key, mem_keys.  OnConnectFn(Fn&&), OnEmptyFn()
+// With index, the per-key signals are registered by window (only for KeyFn::has_window, cf. window_key).
+template <typename EventType, typename KeyFn, typename OnConnectFn, typename OnEmptyFn>
+class signal_for_key : public signal_for_mem_base { // (not final: in_arena)
+  using T = typename KeyFn::type;
+
   struct onempty_key {
-    onempty_key(signal_for_mem &parent, const T &key)
+    onempty_key(signal_for_key &parent, const T &key)
       : parent(parent), key(key)
     { }
 
     void operator()() {
-      parent.map.erase(key);
-      if (parent.map.empty()) {
-        parent.onempty();
+      signal_for_key &p = parent; // (erase destroys *this)
+      p.map.erase(T(key));
+      if (p.map.empty()) {
+        p.onempty();
       }
     }
 
-    signal_for_mem &parent;
+    signal_for_key &parent;
     T key;
   };
 
+  // (own allocation: stays in place, when the flat_map moves its entries)
+  struct keyed_signal : arena_object, window_keyed_base { // (not final: in_arena)
+    keyed_signal(signal_for_key &parent, const T &key, SignalArena *arena)
+      : signal(onempty_key{parent, key}, arena), index(parent.index), win(KeyFn::window(key))
+    {
+      add_to_index();
+    }
+
+    ~keyed_signal() override {
+      if (index) {
+        index->remove(win, this);
+      }
+    }
+
+    void add_to_index() {
+      if (index) {
+        index->add(win, this);
+      }
+    }
+
+    void clear() override {
+      signal.clear();
+    }
+
+    Signal<void(EventType *), onempty_key> signal;
+
+  private:
+    window_index *index;
+    xcb_window_t win;
+  };
+
 public:
-  signal_for_mem(OnConnectFn&& onconnect = {}, OnEmptyFn&& onempty = {})
+  signal_for_key(OnConnectFn&& onconnect = {}, OnEmptyFn&& onempty = {}, SignalArena *arena = nullptr, window_index *index = nullptr)
     : conn(onconnect(*this)),
-      onempty(onempty)
+      onempty(onempty),
+      arena(arena),
+      index((KeyFn::has_window) ? index : nullptr)
   { }
 
-  ~signal_for_mem() override {
+  ~signal_for_key() override {
     conn.disconnect();
   }
 
+  void add_to_index() override {
+    map.for_each([](const T &, arena_ptr<keyed_signal> &sig) {
+      sig->add_to_index();
+    });
+  }
+
   void operator()(EventType *ev) {
-    auto it = map.find(ev->*Mem);
-    if (it != map.end()) {
-      it->second.emit(ev);
+    if (arena_ptr<keyed_signal> *sig = map.find(KeyFn::get(ev))) {
+      (*sig)->signal.emit(ev);
     }
   }
 
   template <typename Fn>
   Connection connect(const T &key, Fn&& fn, SignalFlags flags = {}) {
-    auto res = map.emplace(key, onempty_key{*this, key});
+    auto res = map.emplace(key);
     try {
-      return res.first->second.connect((Fn&&)fn, flags);
+      if (res.second) {
+        *res.first = arena_ptr<keyed_signal>{arena_new<keyed_signal>(arena, *this, key, arena)};
+      }
+      return (*res.first)->signal.connect((Fn&&)fn, flags);
     } catch (...) {
       if (res.second) { // was inserted
         // onempty_key{*this, key}(); ...
@@ -106,19 +283,228 @@ public:
   }
 
 private:
-  std::unordered_map<T, Signal<void(EventType *), onempty_key>> map;
+  flat_map<T, arena_ptr<keyed_signal>, key_hash<T>> map;
   Connection conn;
   OnEmptyFn onempty;
+  SignalArena *arena;
+  window_index *index;
+};
+
+template <typename EventType, typename T, T EventType::*Mem, typename OnConnectFn, typename OnEmptyFn>
+using signal_for_mem = signal_for_key<EventType, mem_key<EventType, T, Mem>, OnConnectFn, OnEmptyFn>;
+
+} // namespace detail
+
+// accumulated Expose / GraphicsExposure rectangles of one window
+struct XcbDamageRegion {
+  void add(const xcb_rectangle_t &r) {
+    if (rects.empty()) {
+      bounds = r;
+    } else {
+      const int x2 = std::max(bounds.x + bounds.width, r.x + r.width), y2 = std::max(bounds.y + bounds.height, r.y + r.height);
+      bounds.x = std::min(bounds.x, r.x);
+      bounds.y = std::min(bounds.y, r.y);
+      bounds.width = x2 - bounds.x;
+      bounds.height = y2 - bounds.y;
+    }
+    for (auto it = rects.begin(); it != rects.end(); ) {
+      if (contains(*it, r)) {
+        return;
+      } else if (contains(r, *it)) {
+        it = rects.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    rects.push_back(r);
+  }
+
+  xcb_rectangle_t bounds = {};
+  std::vector<xcb_rectangle_t> rects;  // (may overlap, but none contains another)
+
+private:
+  static bool contains(const xcb_rectangle_t &a, const xcb_rectangle_t &b) {
+    return a.x <= b.x && a.y <= b.y && a.x + a.width >= b.x + b.width && a.y + a.height >= b.y + b.height;
+  }
+};
+
+namespace detail {
+
+// merges the rectangles of an Expose / GraphicsExposure series per window and emits them once
+// (at count == 0, or by flush()). Listens to the events only while there are handlers.
+class damage_accumulator {
+  using Sig = void(xcb_window_t, const XcbDamageRegion &);
+
+  struct onempty_win {
+    onempty_win(damage_accumulator &parent, xcb_window_t win)
+      : parent(parent), win(win)
+    { }
+
+    void operator()() {
+      damage_accumulator &p = parent; // (erase destroys *this)
+      p.windows.erase(win);
+      p.check_empty();
+    }
+
+    damage_accumulator &parent;
+    xcb_window_t win;
+  };
+
+  struct onempty_all {
+    onempty_all(damage_accumulator &parent) : parent(parent) { }
+
+    void operator()() {
+      parent.check_empty();
+    }
+
+    damage_accumulator &parent;
+  };
+
+public:
+  explicit damage_accumulator(SignalArena *arena)
+    : all(onempty_all{*this}, arena), arena(arena)
+  { }
+
+  damage_accumulator(const damage_accumulator &) = delete;
+  damage_accumulator &operator=(const damage_accumulator &) = delete;
+
+  // win == XCB_NONE: all windows
+  template <typename Parent, typename Fn>
+  Connection on(Parent &parent, xcb_window_t win, Fn&& fn, SignalFlags flags) {
+    if (!expose_conn.connected()) {
+      expose_conn = parent.on_expose([this](xcb_expose_event_t *ev) {
+        add(ev->window, {(int16_t)ev->x, (int16_t)ev->y, ev->width, ev->height}, ev->count == 0);
+      });
+      gexpose_conn = parent.template on<XCB_GRAPHICS_EXPOSURE>([this](xcb_graphics_exposure_event_t *ev) {
+        add(ev->drawable, {(int16_t)ev->x, (int16_t)ev->y, ev->width, ev->height}, ev->count == 0);
+      });
+    }
+    if (win == XCB_NONE) {
+      return all.connect((Fn&&)fn, flags);
+    }
+    auto res = windows.emplace(std::piecewise_construct, std::forward_as_tuple(win), std::forward_as_tuple(onempty_win{*this, win}, arena));
+    return res.first->second.connect((Fn&&)fn, flags);
+  }
+
+  void purge(xcb_window_t win) {
+    auto it = windows.find(win);
+    if (it != windows.end()) {
+      it->second.clear(); // (-> onempty_win)
+    }
+    pending.erase(win);
+  }
+
+  bool contains(xcb_window_t win) const {
+    return windows.find(win) != windows.end();
+  }
+
+  // emits all incomplete series (e.g. when the event queue is drained)
+  void flush() {
+    if (pending.empty()) {
+      return;
+    }
+    std::unordered_map<xcb_window_t, XcbDamageRegion> tmp;
+    tmp.swap(pending);  // (handlers may disconnect, or cause new damage)
+    for (auto &entry : tmp) {
+      emit(entry.first, entry.second);
+    }
+  }
+
+private:
+  void add(xcb_window_t win, const xcb_rectangle_t &rect, bool last) {
+    if (all.empty() && windows.find(win) == windows.end()) {
+      return;
+    }
+    auto it = pending.find(win);
+    if (last && it == pending.end()) { // single rectangle
+      XcbDamageRegion region;
+      region.add(rect);
+      emit(win, region);
+      return;
+    }
+    if (it == pending.end()) {
+      it = pending.emplace(win, XcbDamageRegion{}).first;
+    }
+    it->second.add(rect);
+    if (last) {
+      XcbDamageRegion region = std::move(it->second);
+      pending.erase(it);
+      emit(win, region);
+    }
+  }
+
+  void emit(xcb_window_t win, const XcbDamageRegion &region) {
+    auto it = windows.find(win);
+    if (it != windows.end()) {
+      it->second.emit(win, region);
+    }
+    all.emit(win, region);
+  }
+
+  void check_empty() {
+    if (all.empty() && windows.empty()) {
+      expose_conn.disconnect();
+      gexpose_conn.disconnect();
+      pending.clear();
+    }
+  }
+
+  Signal<Sig, onempty_all, reduce_void> all;
+  std::unordered_map<xcb_window_t, Signal<Sig, onempty_win, reduce_void>> windows;
+  std::unordered_map<xcb_window_t, XcbDamageRegion> pending;
+  Connection expose_conn, gexpose_conn;
+  SignalArena *arena;
 };
 
 } // namespace detail
 
+// handles all events of one window (cf. XcbDemux::attach)
+struct XcbWindowHandler {
+  virtual ~XcbWindowHandler() = default;
+
+  // type: response type (without the send_event bit), one of XCB_FOR_WINDOW_EVENTS
+  virtual void handle_event(uint8_t type, xcb_generic_event_t *ev) = 0;
+};
+
+// CRTP: switches on the type and calls Derived::on_<name>(xcb_<name>_event_t *ev) - for the events Derived defines;
+// the others end in the (empty) defaults below
+//   struct Button : XcbWindowEvents<Button> {
+//     void on_expose(xcb_expose_event_t *ev) { ... }
+//     void on_button_press(xcb_button_press_event_t *ev) { ... }
+//   };
+template <typename Derived>
+struct XcbWindowEvents : XcbWindowHandler {
+  void handle_event(uint8_t type, xcb_generic_event_t *ev) override {
+    Derived &self = static_cast<Derived &>(*this);
+#define HANDLE_CASE(Name, Val, Mem) \
+    case XCB_ ## Val: self.on_ ## Name((xcb_ ## Name ## _event_t *)ev); break;
+
+    switch (type) {
+    XCB_FOR_WINDOW_EVENTS(HANDLE_CASE)
+    }
+#undef HANDLE_CASE
+  }
+
+#define DEFAULT_ONFN(Name, Val, Mem) \
+  void on_ ## Name(xcb_ ## Name ## _event_t *) { }
+
+  XCB_FOR_WINDOW_EVENTS(DEFAULT_ONFN)
+#undef DEFAULT_ONFN
+};
+
 struct XcbDemux : XcbEventCallbacks {
+  // (arena may be shared between several XcbDemux)
+  explicit XcbDemux(SignalArena *arena = nullptr)
+    : XcbEventCallbacks(arena), damage(arena)
+  { }
 
+// (keyed by a window member, cf. detail::window_key)
 #define MAKE_ONFN(Name, Event, Type, Mem) \
   template <typename Fn = void (*)(xcb_ ## Name ## _event_t *)>                                      \
   Connection on_ ## Name (Type val, Fn&& fn, SignalFlags flags = {}) {                               \
-    return _connect_mem<XCB_ ## Event, Type, &xcb_ ## Name ## _event_t:: Mem>(val, (Fn&&)fn, flags); \
+    using E = xcb_ ## Name ## _event_t;                                                              \
+    return _connect_key<XCB_ ## Event, detail::window_key<E, Type, &E:: Mem>>(                       \
+      val, (Fn&&)fn, flags);                                                                         \
   }                                                                                                  \
   template <typename Fn = void (*)(xcb_ ## Name ## _event_t *),                                      \
             typename = typename std::enable_if<!std::is_same<Fn, Type>::value>::type>                \
@@ -126,24 +512,131 @@ struct XcbDemux : XcbEventCallbacks {
     return XcbEventCallbacks::on<XCB_ ## Event>((Fn&&)fn, flags);                                    \
   }
 
-  MAKE_ONFN(key_press, KEY_PRESS, xcb_window_t, event);
-  MAKE_ONFN(key_release, KEY_RELEASE, xcb_window_t, event);
-  MAKE_ONFN(button_press, BUTTON_PRESS, xcb_window_t, event);
-  MAKE_ONFN(button_release, BUTTON_RELEASE, xcb_window_t, event);
-  MAKE_ONFN(motion_notify, MOTION_NOTIFY, xcb_window_t, event);
-  MAKE_ONFN(enter_notify, ENTER_NOTIFY, xcb_window_t, event);
-  MAKE_ONFN(leave_notify, LEAVE_NOTIFY, xcb_window_t, event);
-  MAKE_ONFN(focus_in, FOCUS_IN, xcb_window_t, event);
-  MAKE_ONFN(focus_out, FOCUS_OUT, xcb_window_t, event);
-  MAKE_ONFN(expose, EXPOSE, xcb_window_t, window);
-  // ...
-  MAKE_ONFN(configure_notify, CONFIGURE_NOTIFY, xcb_window_t, window);
-  // ...
-  MAKE_ONFN(client_message, CLIENT_MESSAGE, xcb_window_t, window);
+// only handlers for the exact (val1, val2) are called, e.g. on_property_notify(win, atom, fn); val1 is the window
+#define MAKE_ONFN2(Name, Event, Type1, Mem1, Type2, Mem2) \
+  template <typename Fn = void (*)(xcb_ ## Name ## _event_t *)>                                  \
+  Connection on_ ## Name (Type1 val1, Type2 val2, Fn&& fn, SignalFlags flags = {}) {             \
+    using E = xcb_ ## Name ## _event_t;                                                          \
+    return _connect_key<XCB_ ## Event,                                                           \
+      detail::mem_keys<detail::window_key<E, Type1, &E:: Mem1>, detail::mem_key<E, Type2, &E:: Mem2>>>( \
+        std::make_tuple(val1, val2), (Fn&&)fn, flags);                                           \
+  }
+
+#define MAKE_WIN_ONFN(Name, Val, Mem) MAKE_ONFN(Name, Val, xcb_window_t, Mem)
+
+  // on_key_press(win, fn), ..., on_client_message(win, fn): cf. XCB_FOR_WINDOW_EVENTS
+  XCB_FOR_WINDOW_EVENTS(MAKE_WIN_ONFN)
+
+  MAKE_ONFN2(key_press, KEY_PRESS, xcb_window_t, event, xcb_keycode_t, detail);
+  MAKE_ONFN2(key_release, KEY_RELEASE, xcb_window_t, event, xcb_keycode_t, detail);
+  MAKE_ONFN2(button_press, BUTTON_PRESS, xcb_window_t, event, xcb_button_t, detail);
+  MAKE_ONFN2(button_release, BUTTON_RELEASE, xcb_window_t, event, xcb_button_t, detail);
+  MAKE_ONFN2(property_notify, PROPERTY_NOTIFY, xcb_window_t, window, xcb_atom_t, atom);
+  MAKE_ONFN2(selection_clear, SELECTION_CLEAR, xcb_window_t, owner, xcb_atom_t, selection);
+  MAKE_ONFN2(selection_request, SELECTION_REQUEST, xcb_window_t, owner, xcb_atom_t, selection);
+  MAKE_ONFN2(selection_notify, SELECTION_NOTIFY, xcb_window_t, requestor, xcb_atom_t, selection);
+#undef MAKE_WIN_ONFN
+#undef MAKE_ONFN2
 #undef MAKE_ONFN
 
+  // Expose / GraphicsExposure rectangles merged per window: fn(xcb_window_t win, const XcbDamageRegion &damage) is called
+  // once per series (count == 0) instead of once per rectangle - or earlier via flush_damage(), e.g. as idle function:
+  //   conn.run(dispatch, [&demux]() { demux.flush_damage(); });
+  template <typename Fn>
+  Connection on_damage(xcb_window_t win, Fn&& fn, SignalFlags flags = {}) {
+    return damage.on(*this, win, (Fn&&)fn, flags);
+  }
+
+  template <typename Fn,
+            typename = typename std::enable_if<!std::is_convertible<Fn, xcb_window_t>::value>::type>
+  Connection on_damage(Fn&& fn, SignalFlags flags = {}) {
+    return damage.on(*this, XCB_NONE, (Fn&&)fn, flags);
+  }
+
+  void flush_damage() {
+    damage.flush();
+  }
+
+  // all events of win (cf. XCB_FOR_WINDOW_EVENTS) go to handler: one lookup per event, one entry per window
+  // (vs. one signal_for_mem entry and Connection per on_xxx(win, ...) handler).
+  // One handler per window, a second attach replaces it; handler must stay alive until detach(win).
+  void attach(xcb_window_t win, XcbWindowHandler &handler) {
+    if (route_conns.empty()) {
+      connect_routes();
+    }
+    window_handlers[win] = &handler;
+  }
+
+  // (may be called from the handler itself)
+  bool detach(xcb_window_t win) {
+    if (!window_handlers.erase(win)) {
+      return false;
+    }
+    if (window_handlers.empty()) {
+      for (auto &conn : route_conns) {
+        conn.disconnect();
+      }
+      route_conns.clear();
+    }
+    return true;
+  }
+
+  XcbWindowHandler *window_handler(xcb_window_t win) const {
+    XcbWindowHandler *const *res = window_handlers.find(win);
+    return (res) ? *res : nullptr;
+  }
+
+  // removes everything registered for win: keyed on_xxx(win, ...) handlers (their Connections are disconnected),
+  // on_damage(win, ...), attach(win, ...).  O(handlers of win).
+  // NOTE: handlers registered for all windows (on_xxx(fn)) stay.
+  void purge(xcb_window_t win) {
+    windows().clear(win);
+    damage.purge(win);
+    detach(win);
+  }
+
+  // purge(ev->window) after each DestroyNotify was dispatched (i.e. after the handlers for it ran),
+  // keeps the maps bounded under window churn.
+  // NOTE: only when emitting via XcbDemux (not via a XcbEventCallbacks reference)
+  void set_purge_on_destroy(bool enable) {
+    purge_on_destroy = enable;
+    if (enable) {
+      windows();
+    }
+  }
+
+  bool has_handlers(xcb_window_t win) const {
+    return windows().contains(win) || damage.contains(win) || window_handlers.find(win);
+  }
+
+  using XcbEventCallbacks::emit;
+
+  void emit(uint8_t type, xcb_generic_event_t *ev) {
+    XcbEventCallbacks::emit(type, ev);
+    if (type == XCB_DESTROY_NOTIFY && purge_on_destroy) {
+      purge(((xcb_destroy_notify_event_t *)ev)->window);
+    }
+  }
+
+  void emit(xcb_generic_event_t *ev) {
+    emit(ev->response_type & ~0x80, ev);
+  }
+
+  using XcbEventCallbacks::emit_batch;
+
+  void emit_batch(xcb_generic_event_t *const *evs, size_t n) {
+    XcbEventCallbacks::emit_batch(evs, n);
+    if (purge_on_destroy) {
+      for (size_t i = 0; i < n; i++) {
+        if ((evs[i]->response_type & ~0x80) == XCB_DESTROY_NOTIFY) {
+          purge(((xcb_destroy_notify_event_t *)evs[i])->window);
+        }
+      }
+    }
+  }
+
 protected:
-  using map_t = std::unordered_map<std::pair<uint8_t, std::type_index>, std::unique_ptr<detail::signal_for_mem_base>, detail::pairhash>;
+  using map_t = std::unordered_map<std::pair<uint8_t, std::type_index>, detail::arena_ptr<detail::signal_for_mem_base>, detail::pairhash>;
 
   struct onempty {
     onempty(map_t &mem_map, const std::pair<uint8_t, std::type_index> &key)
@@ -174,18 +667,18 @@ protected:
   };
 
   template <typename EventType,
-            typename T, T EventType::*Mem,
+            typename KeyFn,
             typename DoConnect,
             typename Fn = void (*)(EventType *)>
-  Connection _connect_mem(uint8_t type, const T &val, Fn&& fn, SignalFlags flags, DoConnect&& doconnect) {
+  Connection _connect_key(uint8_t type, const typename KeyFn::type &val, Fn&& fn, SignalFlags flags, DoConnect&& doconnect) {
     // NOTE: we deliberately include DoConnect in type/typeid
-    using sigmem_t = detail::signal_for_mem<EventType, T, Mem, DoConnect, onempty>;
+    using sigmem_t = detail::signal_for_key<EventType, KeyFn, DoConnect, onempty>;
 
     std::pair<uint8_t, std::type_index> key = { type, typeid(sigmem_t) };
     auto &res = mem_map[key];
     if (!res) { // was inserted
       try {
-        std::unique_ptr<sigmem_t> sigmem{new sigmem_t((DoConnect&&)doconnect, {mem_map, key})};
+        detail::arena_ptr<sigmem_t> sigmem{detail::arena_new<sigmem_t>(arena, (DoConnect&&)doconnect, onempty{mem_map, key}, arena, &window_idx)};
         Connection ret = sigmem->connect(val, (Fn&&)fn, flags);
         res = std::move(sigmem);
         return ret;
@@ -199,14 +692,64 @@ protected:
     }
   }
 
+  template <typename EventType,
+            typename T, T EventType::*Mem,
+            typename DoConnect,
+            typename Fn = void (*)(EventType *)>
+  Connection _connect_mem(uint8_t type, const T &val, Fn&& fn, SignalFlags flags, DoConnect&& doconnect) {
+    return _connect_key<EventType, detail::mem_key<EventType, T, Mem>>(type, val, (Fn&&)fn, flags, (DoConnect&&)doconnect);
+  }
+
+  template <uint8_t Type, typename KeyFn,
+            typename EventType = typename detail::event_handler_type<Type>::type,
+            typename Fn = void (*)(EventType *)>
+  Connection _connect_key(const typename KeyFn::type &val, Fn&& fn, SignalFlags flags) {
+    return _connect_key<EventType, KeyFn, connect_on_type<XcbEventCallbacks>>(Type, val, (Fn&&)fn, flags, {*this, Type});
+  }
+
   template <uint8_t Type,
             typename T, T detail::event_handler_type<Type>::type::*Mem,
             typename EventType = typename detail::event_handler_type<Type>::type,
             typename Fn = void (*)(EventType *)>
   Connection _connect_mem(const T &val, Fn&& fn, SignalFlags flags) {
-    return _connect_mem<EventType, T, Mem, connect_on_type<XcbEventCallbacks>>(Type, val, (Fn&&)fn, flags, {*this, Type});
+    return _connect_key<Type, detail::mem_key<EventType, T, Mem>>(val, (Fn&&)fn, flags);
   }
 
+  // window_idx is only filled from the first purge() / has_handlers() / set_purge_on_destroy(true) on;
+  // until then, keyed handlers do not pay for the index
+  detail::window_index &windows() const {
+    if (!window_idx.enabled()) {
+      window_idx.enable();
+      for (auto &kv : mem_map) {
+        kv.second->add_to_index();
+      }
+    }
+    return window_idx;
+  }
+
+  mutable detail::window_index window_idx; // (must outlive mem_map)
   map_t mem_map;
+
+private:
+  void route(uint8_t type, xcb_window_t win, xcb_generic_event_t *ev) {
+    if (XcbWindowHandler **handler = window_handlers.find(win)) {
+      (*handler)->handle_event(type, ev);
+    }
+  }
+
+  void connect_routes() {
+#define CONNECT_ROUTE(Name, Val, Mem) \
+    route_conns.push_back(XcbEventCallbacks::on<XCB_ ## Val>([this](xcb_ ## Name ## _event_t *ev) { \
+      route(XCB_ ## Val, ev->Mem, (xcb_generic_event_t *)ev);                                      \
+    }));
+
+    XCB_FOR_WINDOW_EVENTS(CONNECT_ROUTE)
+#undef CONNECT_ROUTE
+  }
+
+  detail::damage_accumulator damage;
+  detail::flat_map<xcb_window_t, XcbWindowHandler *> window_handlers;
+  std::vector<Connection> route_conns;
+  bool purge_on_destroy = false;
 };
 
@@ -51,13 +51,13 @@ private:
 
 public:
 
-  XcbDemuxWithWM(xcb_atom_t wmprotocols_atom, xcb_atom_t wmdelete_atom)
-    : wmdelete_signal(wmprotocols_atom, wmdelete_atom)
+  XcbDemuxWithWM(xcb_atom_t wmprotocols_atom, xcb_atom_t wmdelete_atom, SignalArena *arena = nullptr)
+    : XcbDemux(arena), wmdelete_signal(wmprotocols_atom, wmdelete_atom)
   { }
 
   // convenience ctor to use retval of win.install_delete_handler()
-  explicit XcbDemuxWithWM(std::pair<xcb_atom_t, xcb_atom_t> wmproto_wmdelete)
-    : XcbDemuxWithWM(wmproto_wmdelete.first, wmproto_wmdelete.second)
+  explicit XcbDemuxWithWM(std::pair<xcb_atom_t, xcb_atom_t> wmproto_wmdelete, SignalArena *arena = nullptr)
+    : XcbDemuxWithWM(wmproto_wmdelete.first, wmproto_wmdelete.second, arena)
   { }
 
   template <typename Fn = void (*)(xcb_client_message_event_t *)>
@@ -67,9 +67,9 @@ public:
 
   template <typename Fn = void (*)(xcb_client_message_event_t *)>
   Connection on_wm_delete(xcb_window_t win, Fn&& fn, SignalFlags flags = {}) {
-    return _connect_mem<
+    return _connect_key<
       xcb_client_message_event_t,
-      xcb_window_t, &xcb_client_message_event_t::window,
+      detail::window_key<xcb_client_message_event_t, xcb_window_t, &xcb_client_message_event_t::window>,
       connect_on_wm_delete>(XCB_CLIENT_MESSAGE, win, (Fn&&)fn, flags, *this);
   }
 
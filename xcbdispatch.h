@@ -0,0 +1,120 @@
+#pragma once
+
+// XcbStaticDispatcher: event routing fixed at compile time - for the innermost loop, when the set of handled events is known.
+// The response type of each handler is inferred from its argument type (detail::event_type_code);
+// aliased structs (e.g. xcb_key_release_event_t is xcb_key_press_event_t) need the code given explicitly via xcb_on<>.
+// A handler taking xcb_generic_event_t * gets all remaining events (put it last).
+// Handlers return void or bool (false: stop, as for XcbConnection::run_once).
+//   auto dispatch = make_xcb_dispatcher(
+//     [](xcb_expose_event_t *ev) { ... },
+//     xcb_on<XCB_KEY_PRESS>([](xcb_key_press_event_t *ev) { ... }),
+//     xcb_on<XCB_KEY_RELEASE>(on_key_release));
+//   conn.run(dispatch);
+
+#include "xcb_base.h" // esp. for xcb_proto.tcc detail::event_type_code
+#include "getargtype.h"
+#include <tuple>
+
+template <uint8_t Code, typename Fn>
+struct XcbOn {
+  Fn fn;
+};
+
+template <uint8_t Code, typename Fn>
+XcbOn<Code, typename std::decay<Fn>::type> xcb_on(Fn&& fn)
+{
+  return {(Fn&&)fn};
+}
+
+namespace detail {
+
+template <typename Fn, typename EventTypePtr, int code>
+struct dispatch_entry_base {
+  using event_type = typename std::remove_cv<typename std::remove_pointer<EventTypePtr>::type>::type;
+  static constexpr bool is_default = std::is_same<event_type, xcb_generic_event_t>::value;
+  static_assert(is_default || code >= 0,
+                "Response type of handler can not be inferred from its argument type, use xcb_on<XCB_...>(fn)");
+
+  using fn_type = Fn;
+  using event_ptr = EventTypePtr;
+  static constexpr int value = code;
+};
+
+template <typename EventTypePtr>
+using event_code_of = event_type_code<typename std::remove_cv<typename std::remove_pointer<EventTypePtr>::type>::type>;
+
+template <typename Handler>
+struct dispatch_entry : dispatch_entry_base<Handler, get_arg_t<1, Handler>, event_code_of<get_arg_t<1, Handler>>::value> {
+  static Handler &fn(Handler &h) { return h; }
+};
+
+template <uint8_t Code, typename Fn>
+struct dispatch_entry<XcbOn<Code, Fn>> : dispatch_entry_base<Fn, get_arg_t<1, Fn>, Code> {
+  static Fn &fn(XcbOn<Code, Fn> &h) { return h.fn; }
+};
+
+} // namespace detail
+
+template <typename... Handlers>
+class XcbStaticDispatcher final {
+  static constexpr size_t N = sizeof...(Handlers);
+
+  template <size_t I>
+  using entry_t = detail::dispatch_entry<typename std::tuple_element<I, std::tuple<Handlers...>>::type>;
+
+  template <bool B>
+  using bool_tag = std::integral_constant<bool, B>;
+
+  template <typename T, typename...>
+  using first_t = typename std::decay<T>::type;
+public:
+  template <typename... Ts,
+            typename = typename std::enable_if<(sizeof...(Ts) == N && N > 0 &&
+                                                !std::is_same<first_t<Ts..., void>, XcbStaticDispatcher>::value)>::type>
+  explicit XcbStaticDispatcher(Ts&&... handlers)
+    : handlers((Ts&&)handlers...)
+  { }
+
+  // true: continue (also for unhandled events)
+  bool operator()(xcb_generic_event_t *ev) {
+    return dispatch<0>(ev->response_type & ~0x80, ev);
+  }
+
+private:
+  // an if-chain on compile-time constants: inlined, and usually turned into a jump table by the compiler
+  template <size_t I>
+  typename std::enable_if<(I < N), bool>::type dispatch(uint8_t type, xcb_generic_event_t *ev) {
+    using entry = entry_t<I>;
+    if (entry::is_default || type == entry::value) {
+      using Ret = decltype(std::declval<typename entry::fn_type &>()((typename entry::event_ptr)ev));
+      return invoke(entry::fn(std::get<I>(handlers)), (typename entry::event_ptr)ev, bool_tag<std::is_void<Ret>::value>{});
+    }
+    return dispatch<I + 1>(type, ev);
+  }
+
+  template <size_t I>
+  typename std::enable_if<(I == N), bool>::type dispatch(uint8_t type, xcb_generic_event_t *ev) {
+    return true;
+  }
+
+  template <typename Fn, typename EventTypePtr>
+  static bool invoke(Fn &fn, EventTypePtr ev, bool_tag<false>) {
+    return fn(ev);
+  }
+
+  template <typename Fn, typename EventTypePtr>
+  static bool invoke(Fn &fn, EventTypePtr ev, bool_tag<true>) {
+    fn(ev);
+    return true;
+  }
+
+private:
+  std::tuple<Handlers...> handlers;
+};
+
+template <typename... Handlers>
+XcbStaticDispatcher<typename std::decay<Handlers>::type...> make_xcb_dispatcher(Handlers&&... handlers)
+{
+  return XcbStaticDispatcher<typename std::decay<Handlers>::type...>{(Handlers&&)handlers...};
+}
+
@@ -2,10 +2,20 @@
 
 #include "signals.h"
 #include "xcb_base.h" // esp. for xcb_proto.tcc detail::event_handler_type
-#include <unordered_map>
 #include "getargtype.h"
+#include "xcb_extensions.h"
+#include <vector>
+
+// InstrumentFn: cf. detail::instrument_none, SignalStats (signals-stats.h) - per event type handler durations
+template <typename InstrumentFn = detail::instrument_none>
+struct BasicXcbEventCallbacks : private detail::instrument_holder<InstrumentFn> {
+  // signal nodes / per-type signals will be allocated from arena
+  explicit BasicXcbEventCallbacks(SignalArena *arena = nullptr)
+    : arena(arena)
+  { }
+
+  using detail::instrument_holder<InstrumentFn>::instrument;
 
-struct XcbEventCallbacks {
   template <typename EventType, typename Fn = void (*)(EventType *)>
   Connection on(uint8_t type, Fn&& fn, SignalFlags flags = {}) {
     return _connect<EventType *>(type, (Fn&&)fn, flags);
@@ -23,77 +33,195 @@ struct XcbEventCallbacks {
     return _connect<EventTypePtr>(type, (Fn&&)fn, flags);
   }
 
+  // fn(EventType *const *evs, size_t n)
+  template <uint8_t type,
+            typename EventType = typename detail::event_handler_type<type>::type,
+            typename Fn>
+  Connection on_batch(Fn&& fn, SignalFlags flags = {}) {
+    return _connect<EventType *, true>(type, (Fn&&)fn, flags);
+  }
+
+  template <typename EventType, typename Fn>
+  Connection on_batch(uint8_t type, Fn&& fn, SignalFlags flags = {}) {
+    return _connect<EventType *, true>(type, (Fn&&)fn, flags);
+  }
+
+  // XGE events (e.g. XInput2, Present): only handlers for (extension major opcode, evtype) are called
+  // (handlers registered with on<XCB_GE_GENERIC> still get all of them)
+  template <typename EventType, typename Fn = void (*)(EventType *)>
+  Connection on_generic(uint8_t ext_opcode, uint16_t evtype, Fn&& fn, SignalFlags flags = {}) {
+    return _connect<EventType *>(ge_key(ext_opcode, evtype), (Fn&&)fn, flags);
+  }
+
+  template <typename Fn, typename EventTypePtr = get_arg_t<1, Fn>>
+  Connection on_generic(uint8_t ext_opcode, uint16_t evtype, Fn&& fn, SignalFlags flags = {}) {
+    return _connect<EventTypePtr>(ge_key(ext_opcode, evtype), (Fn&&)fn, flags);
+  }
+
+  // extension events (cf. xcb_extensions.h), e.g. on_ext<XcbRandr, XCB_RANDR_NOTIFY>(exts, fn).
+  // Returns an unconnected Connection, when the extension is not present.
+  template <typename Ext, uint16_t N,
+            typename EventType = typename detail::ext_event_handler_type<Ext, N>::type,
+            typename Fn = void (*)(EventType *)>
+  Connection on_ext(XcbExtensions &exts, Fn&& fn, SignalFlags flags = {}) {
+    static_assert(detail::ext_event_handler_type<Ext, N>::mapped,
+                  "on_ext<Ext, N>: unknown event - the extension header (e.g. <xcb/randr.h>) must be included before "
+                  "xcbevents.h / xcb_extensions.h; for XcbXkb only N = 0 exists");
+    const xcb_query_extension_reply_t *ext = exts.get<Ext>();
+    if (!ext) {
+      return {};
+    }
+    const uint32_t key = (detail::ext_traits<Ext>::xge) ? ge_key(ext->major_opcode, N) : uint8_t(ext->first_event + N);
+    return _connect<EventType *>(key, (Fn&&)fn, flags);
+  }
+
   void emit(uint8_t type, xcb_generic_event_t *ev) const {
-    auto it = map.find(type);
-    if (it == map.end()) {
+    instr().emitted();
+    if (type == XCB_GE_GENERIC) {
+      emit_generic((xcb_ge_generic_event_t *)ev);
+    }
+    TypedEventSignalBase *signal = table[type].get();
+    if (!signal) {
       return;
     }
-    it->second->emit(ev);
+    auto t = instr().start();
+    signal->emit(ev);
+    instr().event_done(type, t);
   }
 
   void emit(xcb_generic_event_t *ev) const {
     emit(ev->response_type & ~0x80, ev);   // TODO?
   }
 
+  // runs of events with the same type are passed as one batch (cf. Signal::emit_batch)
+  void emit_batch(xcb_generic_event_t *const *evs, size_t n) const {
+    for (size_t i = 0, j; i < n; i = j) {
+      const uint8_t type = evs[i]->response_type & ~0x80;
+      for (j = i + 1; j < n && (evs[j]->response_type & ~0x80) == type; j++) { }
+
+      instr().emitted();
+      if (type == XCB_GE_GENERIC) {
+        for (size_t k = i; k < j; k++) {
+          emit_generic((xcb_ge_generic_event_t *)evs[k]);
+        }
+      }
+      if (TypedEventSignalBase *signal = table[type].get()) {
+        auto t = instr().start();
+        signal->emit_batch(evs + i, j - i);
+        instr().event_done(type, t);
+      }
+    }
+  }
+
+protected:
+  SignalArena *arena;
+
 private:
-  struct TypedEventSignalBase {
-    virtual ~TypedEventSignalBase() = default;
+  InstrumentFn &instr() const { // (emit is const)
+    return const_cast<BasicXcbEventCallbacks *>(this)->instrument();
+  }
+
+  // key: response type, or (for XGE) ext_opcode and evtype in the upper bits (extension opcodes are >= 128, i.e. never 0)
+  static uint32_t ge_key(uint8_t ext_opcode, uint16_t evtype) {
+    return XCB_GE_GENERIC | (ext_opcode << 8) | (uint32_t(evtype) << 16);
+  }
+
+  void emit_generic(xcb_ge_generic_event_t *ev) const {
+    const uint8_t idx = ev->extension & 0x7f;
+    if (idx >= ge_table.size() || ev->event_type >= ge_table[idx].size()) {
+      return;
+    }
+    if (TypedEventSignalBase *signal = ge_table[idx][ev->event_type].get()) {
+      signal->emit((xcb_generic_event_t *)ev);
+    }
+  }
+
+  struct TypedEventSignalBase : detail::arena_object {
     virtual void emit(xcb_generic_event_t *ev) = 0;
+    virtual void emit_batch(xcb_generic_event_t *const *evs, size_t n) = 0;
   };
 
   template <typename EventTypePtr>
-  struct TypedEventSignal final : TypedEventSignalBase {
-    TypedEventSignal(XcbEventCallbacks &parent, uint8_t type)
-      : parent(parent), type(type), signal(*this)
+  struct TypedEventSignal : TypedEventSignalBase { // (not final: detail::in_arena)
+    TypedEventSignal(BasicXcbEventCallbacks &parent, uint32_t key)
+      : parent(parent), key(key), signal(*this, parent.arena)
     { }
 
     void emit(xcb_generic_event_t *ev) override {
       signal.emit((EventTypePtr)ev);
     }
 
+    void emit_batch(xcb_generic_event_t *const *evs, size_t n) override {
+      detail::with_typed_events<EventTypePtr>(evs, n, [this](EventTypePtr const *typed, size_t n) {
+        signal.emit_batch(typed, n);
+      });
+    }
+
     void operator()() const { // onempty
-      parent.map.erase(type);
+      parent.slot(key).reset();
     }
 
     template <typename Fn>
-    Connection connect(Fn&& fn, SignalFlags flags) {
+    Connection connect(Fn&& fn, SignalFlags flags, std::false_type) {
       return signal.connect((Fn&&)fn, flags);
     }
 
+    template <typename Fn>
+    Connection connect(Fn&& fn, SignalFlags flags, std::true_type) { // batch
+      return signal.connect_batch((Fn&&)fn, flags);
+    }
+
   private:
-    XcbEventCallbacks &parent;
-    uint8_t type;
+    BasicXcbEventCallbacks &parent;
+    uint32_t key;
 
     Signal<void(EventTypePtr), TypedEventSignal &, detail::reduce_void> signal;
   };
 
-  template <typename EventTypePtr, typename Fn>
-  Connection _connect(uint8_t type, Fn&& fn, SignalFlags flags) {
-    auto &res = map[type];
-    if (!res) { // was inserted
-      try {
-        std::unique_ptr<TypedEventSignal<EventTypePtr>> signal{new TypedEventSignal<EventTypePtr>{*this, type}};
-        Connection ret = signal->connect((Fn&&)fn, flags);
-        res = std::move(signal);
-        return ret;
-      } catch (...) {
-        map.erase(type); // remove empty unique_ptr from map
-        throw;
-      }
+  template <typename EventTypePtr, bool Batch = false, typename Fn>
+  Connection _connect(uint32_t key, Fn&& fn, SignalFlags flags) {
+    using batch = std::integral_constant<bool, Batch>;
+    auto &res = slot(key);
+    if (!res) {
+      detail::arena_ptr<TypedEventSignal<EventTypePtr>> signal{detail::arena_new<TypedEventSignal<EventTypePtr>>(arena, *this, key)};
+      Connection ret = signal->connect((Fn&&)fn, flags, batch{});
+      res = std::move(signal);
+      return ret;
     } else {
 #if 1
       auto &tmp = *res;  // avoid clang warning for  typeid(*res)
-      if (typeid(TypedEventSignal<EventTypePtr>&) != typeid(tmp)) {
+      if (typeid(TypedEventSignal<EventTypePtr>&) != typeid(tmp) &&
+          typeid(detail::in_arena<TypedEventSignal<EventTypePtr>>&) != typeid(tmp)) {
         throw std::bad_cast();
       }
       TypedEventSignal<EventTypePtr> &signal = static_cast<TypedEventSignal<EventTypePtr> &>(tmp);
 #else
       TypedEventSignal<EventTypePtr> &signal = dynamic_cast<TypedEventSignal<EventTypePtr> &>(*res);
 #endif
-      return signal.connect((Fn&&)fn, flags);
+      return signal.connect((Fn&&)fn, flags, batch{});
     }
   }
 
-  std::unordered_map<uint8_t, std::unique_ptr<TypedEventSignalBase>> map;
+  detail::arena_ptr<TypedEventSignalBase> &slot(uint32_t key) {
+    if (key < 256) {
+      return table[key];
+    }
+    const uint8_t idx = (key >> 8) & 0x7f;
+    const uint16_t evtype = key >> 16;
+    if (idx >= ge_table.size()) {
+      ge_table.resize(idx + 1);
+    }
+    if (evtype >= ge_table[idx].size()) {
+      ge_table[idx].resize(evtype + 1);
+    }
+    return ge_table[idx][evtype];
+  }
+
+  // indexed by response type (without the send_event bit): routing is a single load
+  detail::arena_ptr<TypedEventSignalBase> table[256];
+  // XGE: [ext_opcode & 0x7f][evtype]
+  std::vector<std::vector<detail::arena_ptr<TypedEventSignalBase>>> ge_table;
 };
 
+using XcbEventCallbacks = BasicXcbEventCallbacks<>;
+